@@ -52,28 +52,6 @@ namespace ax
     namespace mw = middleware;
     namespace utl = utilities;
 
-    static void softmax(std::vector<cls::score>& input, int n, int stride)
-    {
-        int i;
-        float sum = 0;
-        float largest = input[0].score;
-        for (i = 0; i < n; ++i)
-        {
-            if (input[i * stride].score > largest)
-                largest = input[i * stride].score;
-        }
-        for (i = 0; i < n; ++i)
-        {
-            float e = exp(input[i * stride].score - largest);
-            sum += e;
-            input[i * stride].score = e;
-        }
-        for (i = 0; i < n; ++i)
-        {
-            input[i * stride].score /= sum;
-        }
-    }
-
     bool run_classification(const std::string& model, const std::string& image_dir, const std::string& val_file)
     {
         // 1. create a runtime handle and load the model
@@ -245,7 +223,7 @@ namespace ax
         int top_1 = 0, top_5 = 0, total = 0;
         cv::Mat mat_input;
         cv::Mat img_new(input_sizes[0], input_sizes[1], CV_8UC3, image.data());
-        std::vector<cls::score> result(1001);
+        std::vector<cls::score> result;
         int cur_index = 0;
 
         // 5. loop the val dataset
@@ -293,19 +271,13 @@ namespace ax
             auto actual_data_size = output.nSize / output.pShape[0] / sizeof(float);
 
             // 1.5 calculate the top1 & top5
-            for (uint32_t id = 0; id < actual_data_size; id++)
-            {
-                result[id].id = id;
-                result[id].score = ptr[id];
-            }
-
-            cls::sort_score(result);
+            cls::topk(ptr, (int)actual_data_size, 5, result);
             auto gt_index_1 = std::stoi(gt_index);
             if (result[0].id == gt_index_1)
             {
                 top_1++;
             }
-            for (int j = 0; j < 5; ++j)
+            for (size_t j = 0; j < result.size(); ++j)
             {
                 if (result[j].id == gt_index_1)
                 {
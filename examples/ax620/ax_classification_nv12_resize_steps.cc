@@ -340,14 +340,8 @@ namespace ax
             auto ptr = (float*)info.pVirAddr;
             auto actual_data_size = output.nSize / output.pShape[0] / sizeof(float);
 
-            std::vector<cls::score> result(actual_data_size);
-            for (uint32_t id = 0; id < actual_data_size; id++)
-            {
-                result[id].id = id;
-                result[id].score = ptr[id];
-            }
-
-            cls::sort_score(result);
+            std::vector<cls::score> result;
+            cls::topk(ptr, (int)actual_data_size, 5, result);
             cls::print_score(result, 5);
         }
 
@@ -25,6 +25,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "base/topk.hpp"
+#include "base/ocr.hpp"
 
 #include "middleware/io.hpp"
 
@@ -42,6 +43,7 @@ const int DEFAULT_IMG_H = 32;
 const int DEFAULT_IMG_W = 256;
 
 const int DEFAULT_LOOP_COUNT = 1;
+const int DEFAULT_BEAM_WIDTH = 0;
 
 namespace ax
 {
@@ -49,55 +51,24 @@ namespace ax
     namespace mw = middleware;
     namespace utl = utilities;
 
-    std::string read_txt(const std::string& filename, int line)
-    {
-        std::ifstream fin;
-        fin.open(filename, std::ios::in);
-        std::string strVec[5530];
-        int i = 0;
-        while (!fin.eof())
-        {
-            std::string inbuf;
-            getline(fin, inbuf, '\n');
-            strVec[i] = inbuf;
-            i = i + 1;
-        }
-        return strVec[line - 1];
-    }
-
-    void process_crnn_result(const float* ocr_data, const char* label_file, int shape0, int shape1)
+    /* key i is class i + 1, class 0 is the ctc blank; outputs are logits */
+    void process_crnn_result(const float* ocr_data, int batch, int length, int char_size, const std::vector<std::string>& keys, int beam_width)
     {
         fprintf(stdout, "--------------------------------------\n");
-        int last_idx = 0;
-        // read key.txt
-        std::string str1;
-        for (int i = 0; i < shape0; i++)
+        timer timer_decode;
+        ocr::CTCDecoder decoder(keys, 1, 0, true);
+        std::vector<ocr::TextLine> lines;
+        decoder.decode(ocr_data, batch, length, char_size, nullptr, beam_width, lines);
+        float decode_cost = timer_decode.cost();
+        for (const auto& line : lines)
         {
-            const float* idx = ocr_data + i * shape1;
-            int max_index = 0;
-            float max_value = -FLT_MAX;
-            for (int j = 0; j < shape1; j++)
-            {
-                float loc = idx[j];
-                if (loc > max_value)
-                {
-                    max_value = loc;
-                    max_index = j;
-                }
-            }
-            if (max_index != 0 && !(max_index > 0 && last_idx == max_index))
-            {
-                str1 = read_txt(label_file, max_index);
-                fprintf(stdout, "%s", str1.c_str());
-                str1 = ' ';
-            }
-            last_idx = max_index;
+            fprintf(stdout, "%s (%.4f)\n", line.text.c_str(), line.score);
         }
-        fprintf(stdout, "\n");
+        fprintf(stdout, "decode cost time:%.2f ms \n", decode_cost);
         fprintf(stdout, "--------------------------------------\n");
     }
 
-    bool run_classification(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, const std::string keys_file)
+    bool run_classification(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, const std::vector<std::string>& keys, int beam_width)
     {
         // 1. create a runtime handle and load the model
         AX_JOINT_HANDLE joint_handle;
@@ -303,10 +274,11 @@ namespace ax
 
             auto ptr = (float*)info.pVirAddr;
 
+            auto batch = output.pShape[0];
             auto length = output.pShape[1];
             auto char_size = output.pShape[2];
 
-            process_crnn_result(ptr, keys_file.c_str(), length, char_size);
+            process_crnn_result(ptr, batch, length, char_size, keys, beam_width);
         }
 
         // 6. show time costs
@@ -346,6 +318,7 @@ int main(int argc, char* argv[])
     cmd.add<std::string>("image", 'i', "image file", true, "");
     cmd.add<std::string>("size", 'g', "input_h, input_w", false, std::to_string(DEFAULT_IMG_H) + "," + std::to_string(DEFAULT_IMG_W));
     cmd.add<std::string>("key", 'k', "key file", true, "keys.txt");
+    cmd.add<int>("beam", 'b', "ctc prefix beam width, 0 for greedy decoding", false, DEFAULT_BEAM_WIDTH);
 
     cmd.add<int>("repeat", 'r', "repeat count", false, DEFAULT_LOOP_COUNT);
     cmd.parse_check(argc, argv);
@@ -389,6 +362,14 @@ int main(int argc, char* argv[])
     }
 
     auto repeat = cmd.get<int>("repeat");
+    auto beam_width = cmd.get<int>("beam");
+
+    std::vector<std::string> keys;
+    if (!ocr::read_dict(keys_file, keys))
+    {
+        fprintf(stderr, "Read key file(%s) failed.\n", keys_file.c_str());
+        return -1;
+    }
 
     // 1. print args
     fprintf(stdout, "--------------------------------------\n");
@@ -428,7 +409,7 @@ int main(int argc, char* argv[])
     fprintf(stdout, "--------------------------------------\n");
 
     // 5. run the processing
-    auto flag = ax::run_classification(model_file, image, repeat, keys_file);
+    auto flag = ax::run_classification(model_file, image, repeat, keys, beam_width);
     if (!flag)
     {
         fprintf(stderr, "Run classification failed.\n");
@@ -24,6 +24,7 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "base/centernet.hpp"
 #include "base/detection.hpp"
 #include "base/common.hpp"
 #include "middleware/io.hpp"
@@ -149,12 +150,13 @@ namespace ax
             int clas;
         };
 
-        void process_hm_message(std::vector<hm_process_object>& hm_process_objects,
-                                int c,
-                                int h,
-                                int w,
-                                const float* hm_max_data,
-                                const float* hm_data)
+        /* the original per cell scan, kept as the reference for --bench */
+        void process_hm_message_loop(std::vector<hm_process_object>& hm_process_objects,
+                                     int c,
+                                     int h,
+                                     int w,
+                                     const float* hm_max_data,
+                                     const float* hm_data)
         {
             for (int j = 0; j < h * w; ++j)
             {
@@ -173,11 +175,63 @@ namespace ax
                 }
             }
 
-            std::sort(hm_process_objects.begin(),
-                      hm_process_objects.end(),
-                      [](const hm_process_object& a, const hm_process_object& b) {
-                          return a.score > b.score;
-                      });
+            std::stable_sort(hm_process_objects.begin(),
+                             hm_process_objects.end(),
+                             [](const hm_process_object& a, const hm_process_object& b) {
+                                 return a.score > b.score;
+                             });
+        }
+
+        /* the model exports the 3x3 max pool of the heatmap, the NHWC [h, w, c] maps are only swept for peaks */
+        void process_hm_message(std::vector<hm_process_object>& hm_process_objects,
+                                int c,
+                                int h,
+                                int w,
+                                const float* hm_max_data,
+                                const float* hm_data)
+        {
+            std::vector<centernet::Peak> peaks;
+            centernet::find_peaks(hm_data, h, w, c, centernet::LAYOUT_NHWC, THRESHOLD, 0, peaks, hm_max_data);
+
+            hm_process_objects.resize(peaks.size());
+            for (size_t i = 0; i < peaks.size(); i++)
+            {
+                hm_process_object& object = hm_process_objects[i];
+                object.pos = peaks[i].y * w + peaks[i].x;
+                object.score = peaks[i].score;
+                object.clas = peaks[i].cls;
+                object.xs = peaks[i].x;
+                object.ys = peaks[i].y;
+            }
+        }
+
+        /* times the reference scan against process_hm_message on the real outputs */
+        void bench_hm_message(int iterations, int c, int h, int w, const float* hm_max_data, const float* hm_data)
+        {
+            std::vector<hm_process_object> expected, actual;
+            timer loop_timer;
+            for (int i = 0; i < iterations; i++)
+            {
+                expected.clear();
+                process_hm_message_loop(expected, c, h, w, hm_max_data, hm_data);
+            }
+            const float loop_cost = loop_timer.cost();
+
+            timer peak_timer;
+            for (int i = 0; i < iterations; i++)
+            {
+                process_hm_message(actual, c, h, w, hm_max_data, hm_data);
+            }
+            const float peak_cost = peak_timer.cost();
+
+            bool same = expected.size() == actual.size();
+            for (size_t i = 0; same && i < expected.size(); i++)
+            {
+                same = expected[i].pos == actual[i].pos && expected[i].clas == actual[i].clas && expected[i].score == actual[i].score;
+            }
+            fprintf(stdout, "--------------------------------------\n");
+            fprintf(stdout, "heatmap peaks, %d iterations: loop %.4f ms, find_peaks %.4f ms, %zu peaks, %s\n",
+                    iterations, loop_cost / iterations, peak_cost / iterations, actual.size(), same ? "same" : "MISMATCH");
         }
 
         void get_reg_data_object(const std::vector<hm_process_object>& hm_process_objects,
@@ -339,7 +393,7 @@ namespace ax
 
     } // namespace mono_process
 
-    bool run_detection(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, cv::Mat& mat, uint32_t input_h, uint32_t input_w)
+    bool run_detection(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, const int& bench, cv::Mat& mat, uint32_t input_h, uint32_t input_w)
     {
         // 1. create a runtime handle and load the model
         AX_JOINT_HANDLE joint_handle;
@@ -553,6 +607,8 @@ namespace ax
         auto meta = io_info->pOutputs[7];
         std::vector<hm_process_object> hm_process_objects;
         process_hm_message(hm_process_objects, meta.pShape[3], meta.pShape[1], meta.pShape[2], data_heatmap_mp, data_heatmap);
+        if (bench > 0)
+            bench_hm_message(bench, meta.pShape[3], meta.pShape[1], meta.pShape[2], data_heatmap_mp, data_heatmap);
 
         // 5.2. get regression data by hm position
         std::vector<reg_process_object> reg_process_objects;
@@ -607,6 +663,7 @@ int main(int argc, char* argv[])
     cmd.add<std::string>("size", 'g', "input_h, input_w", false, std::to_string(DEFAULT_IMG_H) + "," + std::to_string(DEFAULT_IMG_W));
 
     cmd.add<int>("repeat", 'r', "repeat count", false, DEFAULT_LOOP_COUNT);
+    cmd.add<int>("bench", 0, "iterations of the heatmap peak benchmark, 0 is off", false, 0);
     cmd.parse_check(argc, argv);
 
     // 0. get app args, can be removed from user's app
@@ -646,6 +703,7 @@ int main(int argc, char* argv[])
     }
 
     auto repeat = cmd.get<int>("repeat");
+    auto bench = cmd.get<int>("bench");
 
     // 1. print args
     fprintf(stdout, "--------------------------------------\n");
@@ -683,7 +741,7 @@ int main(int argc, char* argv[])
     fprintf(stdout, "--------------------------------------\n");
 
     // 5. run the processing
-    auto flag = ax::run_detection(model_file, image, repeat, mat, input_size[0], input_size[1]);
+    auto flag = ax::run_detection(model_file, image, repeat, bench, mat, input_size[0], input_size[1]);
     if (!flag)
     {
         fprintf(stderr, "Run classification failed.\n");
@@ -25,6 +25,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "base/topk.hpp"
+#include "base/segmentation.hpp"
 #include "base/common.hpp"
 
 #include "middleware/io.hpp"
@@ -244,10 +245,8 @@ namespace ax
         auto& info = joint_io_arr.pOutputs[0];
         auto ptr = (float*)info.pVirAddr;
         auto pixel_num = DEFAULT_IMG_H * DEFAULT_IMG_W;
-        for (int j = 0; j < pixel_num; ++j)
-        {
-            output_mask.data[j] = (uint8_t)(ptr[j] < ptr[j + pixel_num]);
-        }
+        /* background / person planes, the label is the foreground flag */
+        segmentation::argmax_planar(ptr, 2, pixel_num, output_mask.data);
 
         // 6. show time costs
         fprintf(stdout, "--------------------------------------\n");
@@ -25,6 +25,7 @@
 #include <opencv2/opencv.hpp>
 
 #include "base/topk.hpp"
+#include "base/segmentation.hpp"
 
 #include "middleware/io.hpp"
 
@@ -43,7 +44,7 @@ const int DEFAULT_IMG_W = 1024;
 
 const int DEFAULT_LOOP_COUNT = 1;
 
-static const std::vector<std::vector<uint8_t> > CITYSCAPES_COLORS = {
+static const cv::Vec3b CITYSCAPES_COLORS[] = {
     {128, 64, 128}, {244, 35, 232}, {70, 70, 70}, {102, 102, 156}, {190, 153, 153}, {153, 153, 153}, {250, 170, 30}, {220, 220, 0}, {107, 142, 35}, {152, 251, 152}, {70, 130, 180}, {220, 20, 60}, {255, 0, 0}, {0, 0, 142}, {0, 0, 70}, {0, 60, 100}, {0, 80, 100}, {0, 0, 230}, {119, 11, 32}};
 
 namespace ax
@@ -241,20 +242,12 @@ namespace ax
         }
 
         // 5. get output gray
-        cv::Mat output_mat(DEFAULT_IMG_H, DEFAULT_IMG_W, CV_8UC3, cv::Scalar(0));
+        cv::Mat output_mat;
         auto& output = io_info->pOutputs[0];
         auto& info = joint_io_arr.pOutputs[0];
         auto ptr = (uint8_t*)info.pVirAddr;
-        int index = 0;
-        for (int i = 0; i < DEFAULT_IMG_H; ++i)
-        {
-            for (int j = 0; j < DEFAULT_IMG_W; ++j)
-            {
-                auto* ptr_segm = output_mat.ptr<cv::Vec3b>(i, j);
-                const auto& color = CITYSCAPES_COLORS[ptr[index++]];
-                *ptr_segm = cv::Vec3b(color[0], color[1], color[2]);
-            }
-        }
+        cv::Mat labels(DEFAULT_IMG_H, DEFAULT_IMG_W, CV_8UC1, ptr);
+        segmentation::Palette palette(CITYSCAPES_COLORS, sizeof(CITYSCAPES_COLORS) / sizeof(CITYSCAPES_COLORS[0]));
 
         // 6. show time costs
         fprintf(stdout, "--------------------------------------\n");
@@ -277,7 +270,7 @@ namespace ax
                 *min_max_time.first);
 
         // 7. show result
-        cv::resize(output_mat, output_mat, mat.size(), 0, 0, cv::INTER_NEAREST);
+        palette.colorize(labels, output_mat, mat.size());
         float blended_alpha = 0.4;
         output_mat = (1 - blended_alpha) * mat + blended_alpha * output_mat;
         cv::imwrite("./seg_res.jpg", output_mat);
@@ -158,11 +158,11 @@ namespace ax
 
     // nv12 crop resize img
 
-    static void generate_yolox_proposals(std::vector<det::GridAndStride> grid_strides, float* feat_ptr, float prob_threshold, std::vector<det::Object>& objects, int wxc)
+    static void generate_yolox_proposals(const det::GridSpan& grid_strides, float* feat_ptr, float prob_threshold, std::vector<det::Object>& objects, int wxc)
     {
         const int num_grid = 3549;
         const int num_class = 1;
-        const int num_anchors = grid_strides.size();
+        const int num_anchors = grid_strides.size;
 
         for (int anchor_idx = 0; anchor_idx < num_anchors; anchor_idx++)
         {
@@ -173,9 +173,9 @@ namespace ax
             {
                 det::Object obj;
                 // printf("%d,%d\n",num_anchors,anchor_idx);
-                const int grid0 = grid_strides[anchor_idx].grid0;   // 0
-                const int grid1 = grid_strides[anchor_idx].grid1;   // 0
-                const int stride = grid_strides[anchor_idx].stride; // 8
+                const int grid0 = grid_strides.grids[anchor_idx].grid0;   // 0
+                const int grid1 = grid_strides.grids[anchor_idx].grid1;   // 0
+                const int stride = grid_strides.grids[anchor_idx].stride; // 8
                 // yolox/models/yolo_head.py decode logic
                 //  outputs[..., :2] = (outputs[..., :2] + grids) * strides
                 //  outputs[..., 2:4] = torch.exp(outputs[..., 2:4]) * strides
@@ -397,9 +397,8 @@ namespace ax
             auto& output = io_info->pOutputs[i];
             auto& info = joint_io_arr.pOutputs[i];
             auto ptr = (float*)info.pVirAddr;
-            std::vector<det::GridAndStride> grid_stride;
             int wxc = output.pShape[2] * output.pShape[3];
-            det::generate_grids_and_stride(input_w, input_h, stride[i], grid_stride);
+            const det::GridSpan grid_stride = det::GeometryCache::shared().grids(input_w, input_h, stride[i]);
             ax::generate_yolox_proposals(grid_stride, ptr, conf_prob, proporsel, wxc);
         }
         det::get_out_bbox(proporsel, object_bbox, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols);
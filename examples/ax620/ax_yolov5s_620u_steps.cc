@@ -272,17 +272,16 @@ namespace ax
 
         float prob_threshold_unsigmoid = -1.0f * (float)log((1.0f / PROB_THRESHOLD) - 1.0f);
 
+        /* one task per head, decoded on all cores */
+        static utilities::thread_pool pool;
+        static det::DecodeScheduler<det::Object> scheduler(&pool);
         timer timer_postprocess;
+        std::vector<const float*> feats(io_info->nOutputSize);
         for (uint32_t i = 0; i < io_info->nOutputSize; ++i)
         {
-            auto& output = io_info->pOutputs[i];
-            auto& info = joint_io_arr.pOutputs[i];
-
-            auto ptr = (float*)info.pVirAddr;
-
-            int32_t stride = (1 << i) * 8;
-            det::generate_proposals_yolov5(stride, ptr, PROB_THRESHOLD, proposals, input_w, input_h, ANCHORS, prob_threshold_unsigmoid, CLS_NUM);
+            feats[i] = (const float*)joint_io_arr.pOutputs[i].pVirAddr;
         }
+        det::generate_proposals_yolov5(scheduler, feats.data(), (int)feats.size(), PROB_THRESHOLD, proposals, input_w, input_h, ANCHORS, prob_threshold_unsigmoid, CLS_NUM);
 
         det::get_out_bbox(proposals, objects, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols);
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
@@ -11,6 +11,7 @@
 
 #include <opencv2/opencv.hpp>
 #include "base/common.hpp"
+#include "base/depth.hpp"
 #include "base/detection.hpp"
 #include "middleware/io.hpp"
 
@@ -53,31 +54,11 @@ namespace ax
 
         cv::Mat feature(info.pShape[2], info.pShape[3], CV_32FC1, output.pVirAddr);
 
-        double minVal, maxVal;
-        cv::minMaxLoc(feature, &minVal, &maxVal);
-
-		static double minVal_ave=0;
-		static double maxVal_ave=0;
-
-		if(minVal_ave==0)minVal_ave=minVal;
-		if(maxVal_ave==0)maxVal_ave=maxVal;
-
-		minVal_ave=0.5*minVal_ave+0.5*minVal;
-		maxVal_ave=0.5*maxVal_ave+0.5*maxVal;
-
-		feature -= minVal_ave;
-		feature /= (maxVal_ave - minVal_ave);
-		// feature = 1.f - feature;
-		feature *= 255;
-
-        feature.convertTo(feature, CV_8UC1);
-
-        cv::Mat dst(info.pShape[2], info.pShape[3], CV_8UC3);
-        cv::applyColorMap(feature, dst, cv::ColormapTypes::COLORMAP_MAGMA);
-        cv::resize(dst, dst, cv::Size(frame.cols, frame.rows));
-
-        cv::hconcat(std::vector<cv::Mat>{frame, dst}, dst);
-        out_img=dst.clone();
+        /* the range is averaged over frames, so each map is read once and the colors do not flicker */
+        static depth::DepthVisualizer visualizer(cv::COLORMAP_MAGMA, false, 0.5f);
+        out_img.create(frame.rows, frame.cols * 2, CV_8UC3);
+        frame.copyTo(out_img(cv::Rect(0, 0, frame.cols, frame.rows)));
+        visualizer.render(feature, out_img, cv::Rect(frame.cols, 0, frame.cols, frame.rows));
         return true;
     }
     
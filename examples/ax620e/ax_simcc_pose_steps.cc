@@ -42,7 +42,7 @@ const int DEFAULT_LOOP_COUNT = 1;
 
 namespace ax
 {
-    void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, int input_w, int input_h, const std::vector<float>& time_costs)
+    void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, int input_w, int input_h, const cv::Mat& inverse, const std::vector<float>& time_costs)
     {
         timer timer_postprocess;
         auto& info_x = io_info->pOutputs[0];
@@ -51,40 +51,17 @@ namespace ax
         auto& info_y = io_info->pOutputs[1];
         float* output_y = (float*)io_data->pOutputs[1].pVirAddr;
 
+        // one person crop in this sample, the decoder takes a batch of them
+        const int joints = info_x.pShape[1];
         pose::ai_body_parts_s ai_point_result;
+        ai_point_result.keypoints.resize(joints);
+        pose::simcc_decode(output_x, output_y, 1, joints, info_x.pShape[2], info_y.pShape[2], input_w, input_h, &inverse, ai_point_result.keypoints.data());
 
-        for (size_t p = 0; p < info_x.pShape[1]; p++)
+        /* draw_result takes coordinates normalized to the image */
+        for (auto& kp : ai_point_result.keypoints)
         {
-            float x, x_score, y, y_score;
-            float maxval = -FLT_MAX;
-            float maxidx = 0;
-            for (size_t i = 0; i < info_x.pShape[2]; i++)
-            {
-                if (output_x[i] > maxval)
-                {
-                    maxval = output_x[i];
-                    maxidx = i;
-                }
-            }
-            x = maxidx / info_x.pShape[2];
-            x_score = maxval;
-            output_x += info_x.pShape[2];
-
-            maxval = -FLT_MAX;
-            maxidx = 0;
-            for (size_t i = 0; i < info_y.pShape[2]; i++)
-            {
-                if (output_y[i] > maxval)
-                {
-                    maxval = output_y[i];
-                    maxidx = i;
-                }
-            }
-            y = maxidx / info_y.pShape[2];
-            y_score = maxval;
-            output_y += info_y.pShape[2];
-
-            ai_point_result.keypoints.push_back({x, y, (x_score + y_score) / 2});
+            kp.x /= mat.cols;
+            kp.y /= mat.rows;
         }
 
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
@@ -102,7 +79,7 @@ namespace ax
         cv::imwrite("./simcc_out.jpg", mat);
     }
 
-    bool run_model(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, cv::Mat& mat, int input_h, int input_w)
+    bool run_model(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, cv::Mat& mat, int input_h, int input_w, const cv::Mat& inverse)
     {
         // 1. init engine
         AX_ENGINE_NPU_ATTR_T npu_attr;
@@ -169,7 +146,7 @@ namespace ax
         }
 
         // 10. get result
-        post_process(io_info, &io_data, mat, input_w, input_h, time_costs);
+        post_process(io_info, &io_data, mat, input_w, input_h, inverse, time_costs);
         fprintf(stdout, "--------------------------------------\n");
 
         middleware::free_io(&io_data);
@@ -240,7 +217,11 @@ int main(int argc, char* argv[])
         fprintf(stderr, "Read image failed.\n");
         return -1;
     }
-    common::get_input_data_letterbox(mat, image, input_size[0], input_size[1]);
+    // the whole image is the person box here, a detector would give one box per person
+    cv::Mat affine, inverse;
+    pose::crop_transform(cv::Rect2f(0, 0, mat.cols, mat.rows), input_size[1], input_size[0], affine, inverse, 1.f);
+    cv::Mat input(input_size[0], input_size[1], CV_8UC3, image.data());
+    cv::warpAffine(mat, input, affine, cv::Size(input_size[1], input_size[0]));
 
     // 3. sys_init
     AX_SYS_Init();
@@ -248,7 +229,7 @@ int main(int argc, char* argv[])
     // 4. -  engine model  -  can only use AX_ENGINE** inside
     {
         // AX_ENGINE_NPUReset(); // todo ??
-        ax::run_model(model_file, image, repeat, mat, input_size[0], input_size[1]);
+        ax::run_model(model_file, image, repeat, mat, input_size[0], input_size[1], inverse);
 
         // 4.3 engine de init
         AX_ENGINE_Deinit();
@@ -58,7 +58,8 @@ namespace ax
 {
     void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, int input_w, int input_h, const std::vector<float>& time_costs)
     {
-        std::vector<detection::Object> proposals;
+        detection::ProposalBuffer proposals;
+        proposals.reset(0, 3 * NUM_POINT);
         std::vector<detection::Object> objects;
         timer timer_postprocess;
 
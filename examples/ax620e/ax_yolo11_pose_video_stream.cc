@@ -38,6 +38,9 @@
 #include "utilities/cmdline.hpp"
 #include "utilities/file.hpp"
 #include "utilities/timer.hpp"
+#if defined(AX_SAMPLES_COUNT_ALLOCS)
+#include "utilities/alloc_counter.hpp"
+#endif
 
 #include <ax_sys_api.h>
 #include <ax_engine_api.h>
@@ -72,11 +75,14 @@ void msleep(unsigned int milliseconds) {
 namespace ax
 {
     void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, 
-			const cv::Mat& mat,  cv::Mat& out_img, int input_w, int input_h,float time_cost)
+			const cv::Mat& mat,  cv::Mat& out_img, int input_w, int input_h,float time_cost, detection::PostProcessContext& ctx)
     {
-        std::vector<detection::Object> proposals;
-        std::vector<detection::Object> objects;
         timer timer_postprocess;
+#if defined(AX_SAMPLES_COUNT_ALLOCS)
+        utilities::alloc_scope allocations;
+#endif
+        ctx.proposals.reset(0, 3 * NUM_POINT);
+        const detection::LetterboxTransform& letterbox = ctx.letterbox_for(input_h, input_w, mat.rows, mat.cols);
 
         float* output_ptr[3] = {(float*)io_data->pOutputs[0].pVirAddr,      // 1*80*80*65
                                 (float*)io_data->pOutputs[1].pVirAddr,      // 1*40*40*65
@@ -90,11 +96,16 @@ namespace ax
             auto feat_ptr = output_ptr[i];
             auto feat_kps_ptr = output_kps_ptr[i];
             int32_t stride = (1 << i) * 8;
-            detection::generate_proposals_yolov8_pose_native(stride, feat_ptr, feat_kps_ptr, PROB_THRESHOLD, proposals, input_w, input_h, NUM_POINT, NUM_CLASS);
+            detection::generate_proposals_yolov8_pose_native(stride, feat_ptr, feat_kps_ptr, PROB_THRESHOLD, ctx.proposals, input_w, input_h, NUM_POINT, NUM_CLASS, &letterbox);
         }
 
-        detection::get_out_bbox_kps(proposals, objects, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols);
+        detection::get_out_bbox_kps_mapped(ctx, NMS_THRESHOLD);
+        const std::vector<detection::Object>& objects = ctx.objects;
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
+#if defined(AX_SAMPLES_COUNT_ALLOCS)
+        /* drops to 0 once the context buffers reached their working size */
+        fprintf(stdout, "post process allocations: %llu\n", (unsigned long long)allocations.count());
+#endif
         fprintf(stdout, "--------------------------------------\n");
         fprintf(stdout, "time_costs:%.2f ms \n", time_cost);
 
@@ -182,6 +193,8 @@ namespace ax
 		std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 70};
 		streamer.start(7777);
 
+        detection::PostProcessContext ctx;
+
 
         while (cap.isOpened()) {
 
@@ -190,11 +203,10 @@ namespace ax
 			//cv::resize(frame, frame, cv::Size(320, 240)); // 320x240ɃTCY
 
             // Prepare input data
-    		std::vector<uint8_t> image(input_size[0] * input_size[1] * 3, 0);
-		    common::get_input_data_letterbox(frame, image, input_size[0], input_size[1]);
+		    common::get_input_data_letterbox(frame, image_data, input_size[0], input_size[1]);
 
             // Push input and run inference
-            ret = middleware::push_input(image, &io_data, io_info);
+            ret = middleware::push_input(image_data, &io_data, io_info);
             SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
             
             timer tick;
@@ -202,7 +214,7 @@ namespace ax
             float time_cost = tick.cost();
             
             // Post process single frame
-        	post_process(io_info, &io_data, frame, out_img,input_size[1], input_size[0], time_cost);
+        	post_process(io_info, &io_data, frame, out_img,input_size[1], input_size[0], time_cost, ctx);
 
 			std::vector<uchar> buff_bgr;
 			cv::imencode(".jpg", out_img, buff_bgr, params);
@@ -75,19 +75,21 @@ const float NMS_THRESHOLD = 0.45f;
 namespace ax
 {
     void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, cv::Mat& out_img, 
-int input_w, int input_h, const float time_cost)
+int input_w, int input_h, const float time_cost, detection::PostProcessContext& ctx)
     {
-        std::vector<detection::Object> proposals;
-        std::vector<detection::Object> objects;
         timer timer_postprocess;
-        for (int i = 0; i < 3; ++i)
-        {
-            auto feat_ptr = (float*)io_data->pOutputs[i].pVirAddr;
-            int32_t stride = (1 << i) * 8;
-            detection::generate_proposals_yolov8_native(stride, feat_ptr, PROB_THRESHOLD, proposals, input_w, input_h, NUM_CLASS);
-        }
-
-        detection::get_out_bbox(proposals, objects, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols);
+        ctx.object_proposals.clear();
+        const detection::LetterboxTransform& letterbox = ctx.letterbox_for(input_h, input_w, mat.rows, mat.cols);
+        /* the three heads, split into row bands, decode on all four cores */
+        static utilities::thread_pool pool(4);
+        static detection::DecodeScheduler<detection::Object> scheduler(&pool);
+        const float* feats[3] = {(float*)io_data->pOutputs[0].pVirAddr,
+                                 (float*)io_data->pOutputs[1].pVirAddr,
+                                 (float*)io_data->pOutputs[2].pVirAddr};
+        detection::generate_proposals_yolov8_native(scheduler, feats, 3, PROB_THRESHOLD, ctx.object_proposals, input_w, input_h, NUM_CLASS, &letterbox);
+
+        detection::get_out_bbox_mapped(ctx, NMS_THRESHOLD);
+        const std::vector<detection::Object>& objects = ctx.objects;
         fprintf(stdout, "time_costs:%.2f ms \n", time_cost);
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
         fprintf(stdout, "--------------------------------------\n");
@@ -174,6 +176,8 @@ int input_w, int input_h, const float time_cost)
 		std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 70};
 		streamer.start(7777);
 
+        detection::PostProcessContext ctx;
+
         while (cap.isOpened()) {
 
 			cv::Mat frame,out_img;
@@ -181,11 +185,10 @@ int input_w, int input_h, const float time_cost)
 			//cv::resize(frame, frame, cv::Size(320, 240)); // 320x240ɃTCY
 
             // Prepare input data
-    		std::vector<uint8_t> image(input_size[0] * input_size[1] * 3, 0);
-		    common::get_input_data_letterbox(frame, image, input_size[0], input_size[1]);
+		    common::get_input_data_letterbox(frame, image_data, input_size[0], input_size[1]);
 
             // Push input and run inference
-            ret = middleware::push_input(image, &io_data, io_info);
+            ret = middleware::push_input(image_data, &io_data, io_info);
             SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
             
             timer tick;
@@ -193,7 +196,7 @@ int input_w, int input_h, const float time_cost)
             float time_cost = tick.cost();
             
             // Post process single frame
-        	post_process(io_info, &io_data, frame, out_img,input_size[1], input_size[0], time_cost);
+        	post_process(io_info, &io_data, frame, out_img,input_size[1], input_size[0], time_cost, ctx);
 
 			std::vector<uchar> buff_bgr;
 			cv::imencode(".jpg", out_img, buff_bgr, params);
@@ -54,6 +54,7 @@ int NUM_CLASS = 80;
 const int DEFAULT_LOOP_COUNT = 1;
 
 const float PROB_THRESHOLD = 0.25f;
+const int MAX_DETECTIONS = 300;
 
 namespace ax
 {
@@ -61,14 +62,15 @@ namespace ax
     {
         std::vector<detection::Object> objects;
         timer timer_postprocess;
+        std::vector<const float*> feats;
+        std::vector<int> strides;
         for (uint32_t i = 0; i < io_info->nOutputSize; ++i)
         {
-            auto& output = io_data->pOutputs[i];
-            auto& info = io_info->pOutputs[i];
-            auto ptr = (float*)output.pVirAddr;
-            int32_t stride = (1 << i) * 8;
-            detection::generate_proposals_yolov10(stride, ptr, PROB_THRESHOLD, objects, input_w, input_h);
+            feats.push_back((const float*)io_data->pOutputs[i].pVirAddr);
+            strides.push_back((1 << i) * 8);
         }
+        query::TopK top(MAX_DETECTIONS);
+        detection::generate_topk_yolov10(feats, strides, PROB_THRESHOLD, top, objects, input_w, input_h, NUM_CLASS);
 
         detection::get_out_bbox(objects, input_h, input_w, mat.rows, mat.cols);
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
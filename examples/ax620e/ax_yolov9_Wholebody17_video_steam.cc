@@ -46,8 +46,9 @@ namespace ax
 {
 
   bool process_video_frame(AX_ENGINE_HANDLE handle, AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, 
-                           const cv::Mat& frame, cv::Mat& out_img, int input_h, int input_w) {
-        std::vector<uint8_t> image(input_h * input_w * 3, 0);
+                           const cv::Mat& frame, cv::Mat& out_img, int input_h, int input_w,
+                           std::vector<uint8_t>& image, detection::PostProcessContext& ctx) {
+        image.resize(input_h * input_w * 3);
         common::get_input_data_letterbox(frame, image, input_h, input_w);
         
         auto ret = middleware::push_input(image, io_data, io_info);
@@ -57,17 +58,16 @@ namespace ax
         ret = AX_ENGINE_RunSync(handle, io_data);
         float time_cost = tick.cost();
         
-        std::vector<detection::Object> proposals;
-        std::vector<detection::Object> objects;
+        ctx.object_proposals.clear();
         
         for (int i = 0; i < 3; ++i) {
             auto feat_ptr = (float*)io_data->pOutputs[i].pVirAddr;
             int32_t stride = (1 << i) * 8;
-            detection::generate_proposals_yolov9(stride, feat_ptr, PROB_THRESHOLD, proposals, input_w, input_h, NUM_CLASS);
+            detection::generate_proposals_yolov9(stride, feat_ptr, PROB_THRESHOLD, ctx.object_proposals, input_w, input_h, NUM_CLASS);
         }
         
-        detection::get_out_bbox(proposals, objects, NMS_THRESHOLD, input_h, input_w, frame.rows, frame.cols);
-        detection::draw_objects(frame,out_img, objects, CLASS_NAMES, "");
+        detection::get_out_bbox(ctx, NMS_THRESHOLD, input_h, input_w, frame.rows, frame.cols);
+        detection::draw_objects(frame,out_img, ctx.objects, CLASS_NAMES, "");
         
         return true;
     }
@@ -149,6 +149,8 @@ namespace ax
 		std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 70};
 		streamer.start(7778);
 
+        detection::PostProcessContext ctx;
+
 	    std::chrono::steady_clock::time_point Cbegin, Cend;
 	    std::chrono::steady_clock::time_point Tbegin, Tend;
 
@@ -163,7 +165,7 @@ namespace ax
 			Cend = std::chrono::steady_clock::now();
 
 			Tbegin = std::chrono::steady_clock::now();
-			if (!process_video_frame(handle, io_info, &io_data, frame,out_img,input_size[1], input_size[0])) {
+			if (!process_video_frame(handle, io_info, &io_data, frame,out_img,input_size[1], input_size[0], image_data, ctx)) {
 			     break;
 			 }
 			Tend = std::chrono::steady_clock::now();
@@ -51,13 +51,8 @@ namespace ax
         auto& info = io_info->pOutputs[0];
         auto ptr = (float*)output.pVirAddr;
         auto class_num = info.nSize / sizeof(float);
-        std::vector<classification::score> result(class_num);
-        for (uint32_t id = 0; id < class_num; id++)
-        {
-            result[id].id = id;
-            result[id].score = ptr[id];
-        }
-        classification::sort_score(result);
+        std::vector<classification::score> result;
+        classification::topk(ptr, (int)class_num, 5, result);
         fprintf(stdout, "topk cost time:%.2f ms \n", timer_postprocess.cost());
         classification::print_score(result, 5);
 
@@ -44,123 +44,11 @@ const float PROB_THRESHOLD = 0.5f;
 
 namespace ax
 {
-    static void shift(int w, int h, int stride, std::vector<float> anchor_points, std::vector<float>& shifted_anchor_points)
-    {
-        std::vector<float> x_, y_;
-        for (int i = 0; i < w; i++)
-        {
-            float x = (i + 0.5) * stride;
-            x_.push_back(x);
-        }
-        for (int i = 0; i < h; i++)
-        {
-            float y = (i + 0.5) * stride;
-            y_.push_back(y);
-        }
-
-        std::vector<float> shift_x(w * h, 0), shift_y(w * h, 0);
-        for (int i = 0; i < h; i++)
-        {
-            for (int j = 0; j < w; j++)
-            {
-                shift_x[i * w + j] = x_[j];
-            }
-        }
-        for (int i = 0; i < h; i++)
-        {
-            for (int j = 0; j < w; j++)
-            {
-                shift_y[i * w + j] = y_[i];
-            }
-        }
-
-        std::vector<float> shifts(w * h * 2, 0);
-        for (int i = 0; i < w * h; i++)
-        {
-            shifts[i * 2] = shift_x[i];
-            shifts[i * 2 + 1] = shift_y[i];
-        }
-
-        shifted_anchor_points.resize(2 * w * h * anchor_points.size() / 2, 0);
-        for (int i = 0; i < w * h; i++)
-        {
-            for (int j = 0; j < (int)anchor_points.size() / 2; j++)
-            {
-                float x = anchor_points[j * 2] + shifts[i * 2];
-                float y = anchor_points[j * 2 + 1] + shifts[i * 2 + 1];
-                shifted_anchor_points[i * anchor_points.size() / 2 * 2 + j * 2] = x;
-                shifted_anchor_points[i * anchor_points.size() / 2 * 2 + j * 2 + 1] = y;
-            }
-        }
-    }
-    static void generate_anchor_points(int stride, int row, int line, std::vector<float>& anchor_points)
-    {
-        float row_step = (float)stride / row;
-        float line_step = (float)stride / line;
-
-        std::vector<float> x_, y_;
-        for (int i = 1; i < line + 1; i++)
-        {
-            float x = (i - 0.5) * line_step - stride / 2;
-            x_.push_back(x);
-        }
-        for (int i = 1; i < row + 1; i++)
-        {
-            float y = (i - 0.5) * row_step - stride / 2;
-            y_.push_back(y);
-        }
-        std::vector<float> shift_x(row * line, 0), shift_y(row * line, 0);
-        for (int i = 0; i < row; i++)
-        {
-            for (int j = 0; j < line; j++)
-            {
-                shift_x[i * line + j] = x_[j];
-            }
-        }
-        for (int i = 0; i < row; i++)
-        {
-            for (int j = 0; j < line; j++)
-            {
-                shift_y[i * line + j] = y_[i];
-            }
-        }
-        anchor_points.resize(row * line * 2, 0);
-        for (int i = 0; i < row * line; i++)
-        {
-            float x = shift_x[i];
-            float y = shift_y[i];
-            anchor_points[i * 2] = x;
-            anchor_points[i * 2 + 1] = y;
-        }
-    }
-    static void generate_anchor_points(int img_w, int img_h, std::vector<int> pyramid_levels, int row, int line, std::vector<float>& all_anchor_points)
-    {
-        std::vector<std::pair<int, int> > image_shapes;
-        std::vector<int> strides;
-        for (int i = 0; i < (int)pyramid_levels.size(); i++)
-        {
-            int new_h = std::floor((img_h + std::pow(2, pyramid_levels[i]) - 1) / std::pow(2, pyramid_levels[i]));
-            int new_w = std::floor((img_w + std::pow(2, pyramid_levels[i]) - 1) / std::pow(2, pyramid_levels[i]));
-            image_shapes.push_back(std::make_pair(new_w, new_h));
-            strides.push_back(std::pow(2, pyramid_levels[i]));
-        }
-
-        all_anchor_points.clear();
-        for (int i = 0; i < (int)pyramid_levels.size(); i++)
-        {
-            std::vector<float> anchor_points;
-            generate_anchor_points(std::pow(2, pyramid_levels[i]), row, line, anchor_points);
-            std::vector<float> shifted_anchor_points;
-            shift(image_shapes[i].first, image_shapes[i].second, strides[i], anchor_points, shifted_anchor_points);
-            all_anchor_points.insert(all_anchor_points.end(), shifted_anchor_points.begin(), shifted_anchor_points.end());
-        }
-    }
-
     void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, int input_w, int input_h, const std::vector<float>& time_costs)
     {
-        std::vector<int> pyramid_levels(1, 3);
-        std::vector<float> all_anchor_points;
-        generate_anchor_points(input_w, input_h, pyramid_levels, 2, 2, all_anchor_points);
+        static const std::vector<int> pyramid_levels(1, 3);
+        /* built once per input size */
+        const detection::PointSpan anchor_points = detection::GeometryCache::shared().anchor_points(input_w, input_h, pyramid_levels, 2, 2);
 
         timer timer_postprocess;
 
@@ -198,7 +86,7 @@ namespace ax
 
         int len = io_data->pOutputs[0].nSize / sizeof(float) / 2;
 
-        crowd_point_t* anchor_points_ptr = (crowd_point_t*)all_anchor_points.data();
+        const crowd_point_t* anchor_points_ptr = (const crowd_point_t*)anchor_points.points;
 
         std::vector<float> _softmax_result(2, 0);
         std::vector<cv::Point> points;
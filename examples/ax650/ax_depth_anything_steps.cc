@@ -24,6 +24,7 @@
 
 #include <opencv2/opencv.hpp>
 #include "base/common.hpp"
+#include "base/depth.hpp"
 #include "base/detection.hpp"
 #include "middleware/io.hpp"
 
@@ -50,19 +51,11 @@ namespace ax
 
         cv::Mat feature(info.pShape[2], info.pShape[3], CV_32FC1, output.pVirAddr);
 
-        double minVal, maxVal;
-        cv::minMaxLoc(feature, &minVal, &maxVal);
-
-        feature -= minVal;
-        feature /= (maxVal - minVal);
-        // feature = 1.f - feature;
-        feature *= 255;
-
-        feature.convertTo(feature, CV_8UC1);
-
-        cv::Mat dst(info.pShape[2], info.pShape[3], CV_8UC3);
-        cv::applyColorMap(feature, dst, cv::ColormapTypes::COLORMAP_MAGMA);
-        cv::resize(dst, dst, cv::Size(mat.cols, mat.rows));
+        /* input on the left, colored depth rendered straight into the right half */
+        cv::Mat dst(mat.rows, mat.cols * 2, CV_8UC3);
+        mat.copyTo(dst(cv::Rect(0, 0, mat.cols, mat.rows)));
+        depth::DepthVisualizer visualizer(cv::COLORMAP_MAGMA);
+        visualizer.render(feature, dst, cv::Rect(mat.cols, 0, mat.cols, mat.rows));
 
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
         fprintf(stdout, "--------------------------------------\n");
@@ -75,7 +68,6 @@ namespace ax
                 *min_max_time.second,
                 *min_max_time.first);
         fprintf(stdout, "--------------------------------------\n");
-        cv::hconcat(std::vector<cv::Mat>{mat, dst}, dst);
         cv::imwrite("depth_anything_out.png", dst);
     }
 
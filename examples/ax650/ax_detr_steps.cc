@@ -63,6 +63,7 @@ const char* CLASS_NAMES_91[] = {
 const int DEFAULT_LOOP_COUNT = 1;
 
 const float PROB_THRESHOLD = 0.9f;
+const int MAX_DETECTIONS = 100;
 
 namespace ax
 {
@@ -92,34 +93,30 @@ namespace ax
         float* output_prob = (float*)io_data->pOutputs[prob_pred_idx].pVirAddr;
         float* output_bbox = (float*)io_data->pOutputs[bbox_pred_idx].pVirAddr;
 
-        for (size_t i = 0; i < info.pShape[1]; i++)
+        /* the last class is "no object", a query competes with its best real class */
+        const int queries = info.pShape[1];
+        const int classes = io_info->pOutputs[prob_pred_idx].pShape[2];
+        const int box_size = io_info->pOutputs[bbox_pred_idx].pShape[2];
+        query::TopK top(MAX_DETECTIONS);
+        top.clear(PROB_THRESHOLD);
+        std::vector<float> prob(classes);
+        for (int q = 0; q < queries; q++)
         {
-            int maxid = -1;
-            float maxval = -FLT_MAX;
-            float dst[92];
-            detection::softmax(output_prob, &dst[0], io_info->pOutputs[prob_pred_idx].pShape[2]);
-            for (size_t j = 0; j < io_info->pOutputs[prob_pred_idx].pShape[2] - 1; j++)
-            {
-                if (dst[j] > maxval)
-                {
-                    maxval = dst[j];
-                    maxid = j;
-                }
-            }
+            detection::softmax(output_prob + (size_t)q * classes, prob.data(), classes);
+            query::select_best(prob.data(), 1, classes - 1, classes, top, q);
+        }
 
-            if (maxval > PROB_THRESHOLD)
-            {
-                detection::Object obj;
-                obj.label = maxid;
-                obj.prob = maxval;
-                obj.rect.x = (output_bbox[0] - 0.5 * output_bbox[2]) * input_w;
-                obj.rect.y = (output_bbox[1] - 0.5 * output_bbox[3]) * input_h;
-                obj.rect.width = output_bbox[2] * input_w;
-                obj.rect.height = output_bbox[3] * input_h;
-                objects.push_back(obj);
-            }
-            output_prob += io_info->pOutputs[prob_pred_idx].pShape[2];
-            output_bbox += io_info->pOutputs[bbox_pred_idx].pShape[2];
+        for (const auto& c : top.sorted())
+        {
+            const float* box = output_bbox + (size_t)c.query * box_size;
+            detection::Object obj;
+            obj.label = c.label;
+            obj.prob = c.score;
+            obj.rect.x = (box[0] - 0.5 * box[2]) * input_w;
+            obj.rect.y = (box[1] - 0.5 * box[3]) * input_h;
+            obj.rect.width = box[2] * input_w;
+            obj.rect.height = box[3] * input_h;
+            objects.push_back(obj);
         }
 
         detection::get_out_bbox(objects, input_h, input_w, mat.rows, mat.cols);
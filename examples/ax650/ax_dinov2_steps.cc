@@ -25,6 +25,7 @@
 #include <opencv2/opencv.hpp>
 #include "base/common.hpp"
 #include "base/detection.hpp"
+#include "base/projection.hpp"
 #include "middleware/io.hpp"
 
 #include "utilities/args.hpp"
@@ -42,30 +43,65 @@ const int DEFAULT_LOOP_COUNT = 1;
 
 namespace ax
 {
-    void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, int input_w, int input_h, const std::vector<float>& time_costs)
+    bool post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, int input_w, int input_h, const std::string& basis_file, const std::vector<float>& time_costs)
     {
-        timer timer_postprocess;
         auto& output = io_data->pOutputs[0];
         auto& info = io_info->pOutputs[0];
 
-        cv::Mat feature(info.pShape[1], info.pShape[2], CV_32FC1, output.pVirAddr);
-        cv::resize(feature, feature, cv::Size(info.pShape[2] / 4, info.pShape[1]));
+        // patch grid from the token count of the [1, tokens, dim] output
+        const int tokens = info.pShape[1];
+        const int dim = info.pShape[2];
+        int grid_h, grid_w, prefix;
+        if (!projection::token_grid(tokens, input_h, input_w, grid_h, grid_w, prefix))
+        {
+            fprintf(stderr, "Output tokens(%d) do not fit a patch grid of %dx%d input.\n", tokens, input_h, input_w);
+            return false;
+        }
+        const int patches = grid_h * grid_w;
+        const float* features = (const float*)output.pVirAddr + (size_t)prefix * dim;
 
-        cv::PCA pca(feature, cv::noArray(), cv::PCA::Flags::USE_AVG, 3);
-        cv::Mat pca_features = pca.project(feature);
-        double minVal, maxVal;
-        cv::minMaxLoc(pca_features, &minVal, &maxVal);
-        pca_features -= minVal;
-        pca_features /= (maxVal - minVal);
-        pca_features *= 255;
-
-        cv::Mat out(37, 37, CV_8UC3);
-        float* pca_features_data = (float*)pca_features.data;
-        uchar* out_data = out.data;
-        for (size_t i = 0; i < pca_features.cols * pca_features.rows; i++)
+        // fit the basis once, later runs only project
+        projection::PCAProjector pca(3);
+        if (!basis_file.empty() && utilities::file_exist(basis_file))
         {
-            out_data[i] = pca_features_data[i] > UCHAR_MAX ? UCHAR_MAX : pca_features_data[i];
+            if (!pca.load(basis_file))
+            {
+                fprintf(stderr, "Read pca basis(%s) failed.\n", basis_file.c_str());
+                return false;
+            }
+            if (pca.dim() != dim || pca.components() != 3)
+            {
+                fprintf(stderr, "Pca basis(%s) is %d components of dim %d, the model needs 3 of dim %d.\n",
+                        basis_file.c_str(), pca.components(), pca.dim(), dim);
+                return false;
+            }
+            fprintf(stdout, "pca basis %s loaded\n", basis_file.c_str());
         }
+        else
+        {
+            timer timer_fit;
+            if (!pca.fit(features, patches, dim))
+            {
+                fprintf(stderr, "PCA fit failed.\n");
+                return false;
+            }
+            fprintf(stdout, "pca fit cost time:%.2f ms \n", timer_fit.cost());
+            if (!basis_file.empty())
+            {
+                bool saved = pca.save(basis_file);
+                fprintf(stdout, "pca basis %s %s\n", basis_file.c_str(), saved ? "saved" : "save failed");
+            }
+        }
+
+        timer timer_postprocess;
+        cv::Mat pca_features(grid_h, grid_w, CV_32FC3);
+        pca.project(features, patches, (float*)pca_features.data);
+
+        double minVal, maxVal;
+        cv::minMaxLoc(pca_features.reshape(1), &minVal, &maxVal);
+        const double alpha = maxVal > minVal ? 255.0 / (maxVal - minVal) : 0.0;
+        cv::Mat out;
+        pca_features.convertTo(out, CV_8UC3, alpha, -minVal * alpha);
         cv::resize(out, out, cv::Size(mat.cols, mat.rows));
 
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
@@ -84,9 +120,10 @@ namespace ax
         cv::Mat dst;
         cv::addWeighted(mat, 0.4, out, 0.6, 0, dst);
         cv::imwrite("dinov2_out.png", dst);
+        return true;
     }
 
-    bool run_model(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, cv::Mat& mat, int input_h, int input_w)
+    bool run_model(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, cv::Mat& mat, int input_h, int input_w, const std::string& basis_file)
     {
         // 1. init engine
 #ifdef AXERA_TARGET_CHIP_AX620E
@@ -156,11 +193,12 @@ namespace ax
         }
 
         // 10. get result
-        post_process(io_info, &io_data, mat, input_w, input_h, time_costs);
+        bool ok = post_process(io_info, &io_data, mat, input_w, input_h, basis_file, time_costs);
         fprintf(stdout, "--------------------------------------\n");
 
         middleware::free_io(&io_data);
-        return AX_ENGINE_DestroyHandle(handle);
+        ret = AX_ENGINE_DestroyHandle(handle);
+        return ok && 0 == ret;
     }
 } // namespace ax
 
@@ -171,6 +209,7 @@ int main(int argc, char* argv[])
     cmd.add<std::string>("image", 'i', "image file", true, "");
     cmd.add<std::string>("size", 'g', "input_h, input_w", false, std::to_string(DEFAULT_IMG_H) + "," + std::to_string(DEFAULT_IMG_W));
 
+    cmd.add<std::string>("basis", 'b', "pca basis file, loaded when it exists, else fit on this image and saved; a basis of another dim is an error", false, "");
     cmd.add<int>("repeat", 'r', "repeat count", false, DEFAULT_LOOP_COUNT);
     cmd.parse_check(argc, argv);
 
@@ -211,6 +250,7 @@ int main(int argc, char* argv[])
     }
 
     auto repeat = cmd.get<int>("repeat");
+    auto basis_file = cmd.get<std::string>("basis");
 
     // 1. print args
     fprintf(stdout, "--------------------------------------\n");
@@ -233,9 +273,10 @@ int main(int argc, char* argv[])
     AX_SYS_Init();
 
     // 4. -  engine model  -  can only use AX_ENGINE** inside
+    bool ok;
     {
         // AX_ENGINE_NPUReset(); // todo ??
-        ax::run_model(model_file, image, repeat, mat, input_size[0], input_size[1]);
+        ok = ax::run_model(model_file, image, repeat, mat, input_size[0], input_size[1], basis_file);
 
         // 4.3 engine de init
         AX_ENGINE_Deinit();
@@ -244,5 +285,5 @@ int main(int argc, char* argv[])
     // 4. -  engine model  -
 
     AX_SYS_Deinit();
-    return 0;
+    return ok ? 0 : -1;
 }
@@ -24,6 +24,7 @@
 
 #include <opencv2/opencv.hpp>
 #include "base/common.hpp"
+#include "base/segmentation.hpp"
 #include "middleware/io.hpp"
 
 #include "utilities/args.hpp"
@@ -52,28 +53,16 @@ namespace ax
         int width = info.pShape[2];
         int channel = info.pShape[3];
 
-        cv::Mat mask(height, width, CV_8UC1, cv::Scalar(0));
-
-        for (size_t y = 0; y < height; y++)
-        {
-            for (size_t x = 0; x < width; x++)
-            {
-                if (ptr[y * width * channel + x * channel + 1] > ptr[y * width * channel + x * channel + 0] &&
-                    ptr[y * width * channel + x * channel + 1] > 0.3)
-                {
-                }
-                else
-                {
-                    mask.at<uchar>(y, x) = 255;
-                }
-            }
-        }
+        /* NHWC scores, label 1 is the person when it wins with more than 0.3 */
+        cv::Mat labels(height, width, CV_8UC1);
+        segmentation::argmax_interleaved(ptr, channel, height * width, labels.data, 0.3f);
+        cv::Mat mask = labels != 1;
 
         fprintf(stdout, "cost time:%.2f ms \n", timer_postprocess.cost());
 
         cv::rotate(mask, mask, cv::ROTATE_90_CLOCKWISE);
         cv::flip(mask, mask, 1);
-        cv::resize(mask, mask, cv::Size(mat.cols, mat.rows));
+        segmentation::resize_labels(mask, cv::Size(mat.cols, mat.rows), mask);
 
         cv::Mat result = mat.clone();
         result.setTo(cv::Scalar(0, 0, 0), mask);
@@ -24,6 +24,7 @@
 
 #include <opencv2/opencv.hpp>
 #include "base/common.hpp"
+#include "base/segmentation.hpp"
 #include "middleware/io.hpp"
 
 #include "utilities/args.hpp"
@@ -73,22 +74,14 @@ namespace ax
             {135, 88, 156},
         };
 
-        cv::Mat mask(height, width, CV_8UC3, cv::Scalar(0, 0, 0));
+        cv::Mat labels(height, width, CV_8UC1);
+        cv::Mat mask;
 
-        for (size_t y = 0; y < height; y++)
-        {
-            for (size_t x = 0; x < width; x++)
-            {
-                mask.at<cv::Vec3b>(y, x) = colors[int(ptr[y * width + x])];
-            }
-        }
+        segmentation::index_map(ptr, height * width, num_class, labels.data);
+        segmentation::Palette(colors, num_class).colorize(labels, mask, cv::Size(mat.cols, mat.rows));
 
         fprintf(stdout, "cost time:%.2f ms \n", timer_postprocess.cost());
 
-        // cv::rotate(mask, mask, cv::ROTATE_90_CLOCKWISE);
-        // cv::flip(mask, mask, 1);
-        cv::resize(mask, mask, cv::Size(mat.cols, mat.rows));
-
         cv::imwrite("pp_liteseg_stdc2_cityscapes_out.jpg", mask);
 
         fprintf(stdout, "--------------------------------------\n");
@@ -34,87 +34,24 @@
 #include <ax_sys_api.h>
 #include <ax_engine_api.h>
 
-#include "base/score.hpp"
-#include "base/topk.hpp"
+#include "base/ocr.hpp"
 
-const int DEFAULT_IMG_H = 48;
-const int DEFAULT_IMG_W = 320;
+const int DEFAULT_BEAM_WIDTH = 0;
 const int DEFAULT_LOOP_COUNT = 1;
 
+/* padding that is 0 after the (x / 255 - 0.5) / 0.5 input normalization, like PaddleOCR pads */
+const uint8_t PAD_VALUE = 127;
+
 namespace ax
 {
-    std::vector<std::string> ReadDict(const std::string &path)
+    void post_process(const std::vector<std::string> &paths, const std::vector<ocr::TextLine> &lines, float decode_cost, const std::vector<float> &time_costs)
     {
-        std::ifstream in(path);
-        std::string line;
-        std::vector<std::string> m_vec;
-        if (in)
-        {
-            while (getline(in, line))
-            {
-                m_vec.push_back(line);
-            }
-        }
-        else
+        for (size_t i = 0; i < lines.size(); i++)
         {
-            std::cout << "no such label file: " << path << ", exit the program..."
-                      << std::endl;
-            exit(1);
+            fprintf(stdout, "%s: %s (%.4f)\n", paths[i].c_str(), lines[i].text.c_str(), lines[i].score);
         }
-        return m_vec;
-    }
 
-    template <class ForwardIterator>
-    inline static size_t argmax(ForwardIterator first, ForwardIterator last, ForwardIterator val)
-    {
-        ForwardIterator max_val = std::max_element(first, last);
-        *val = *max_val;
-        return std::distance(first, max_val);
-    }
-
-    void post_process(AX_ENGINE_IO_INFO_T *io_info, AX_ENGINE_IO_T *io_data, const cv::Mat &mat, std::vector<std::string> &label_list_, const std::vector<float> &time_costs)
-    {
-        timer timer_postprocess;
-
-        auto &output = io_data->pOutputs[0];
-        auto &info = io_info->pOutputs[0];
-        auto ptr = (float *)output.pVirAddr;
-
-        int cnt = info.pShape[1];
-        int width = info.pShape[2];
-
-        std::string str_res;
-        int argmax_idx;
-        int last_index = 0;
-        float score = 0.f;
-        int count = 0;
-        float max_value = 0.0f;
-
-        for (int n = 0; n < info.pShape[1]; n++)
-        {
-            printf("%f\n",ptr[0]);
-            // get idx
-            argmax_idx = int(argmax(
-                &ptr[(1 * info.pShape[1] + n) * info.pShape[2]],
-                &ptr[(1 * info.pShape[1] + n + 1) * info.pShape[2]], &max_value));
-            // get score
-            // max_value = float(*std::max_element(
-            //     &ptr[(1 * info.pShape[1] + n) * info.pShape[2]],
-            //     &ptr[(1 * info.pShape[1] + n + 1) * info.pShape[2]]));
-
-            if (argmax_idx > 0 && (!(n > 0 && argmax_idx == last_index)))
-            {
-                printf("%d %.4f\n", argmax_idx, max_value);
-                score += max_value;
-                count += 1;
-                str_res += label_list_[argmax_idx];
-            }
-            last_index = argmax_idx;
-        }
-
-        fprintf(stdout, "ppocr rec:%s \n", str_res.c_str());
-
-        fprintf(stdout, "cost time:%.2f ms \n", timer_postprocess.cost());
+        fprintf(stdout, "decode %zu lines cost time:%.2f ms \n", lines.size(), decode_cost);
 
         fprintf(stdout, "--------------------------------------\n");
         auto total_time = std::accumulate(time_costs.begin(), time_costs.end(), 0.f);
@@ -127,7 +64,7 @@ namespace ax
                 *min_max_time.first);
     }
 
-    bool run_model(const std::string &model, const std::vector<uint8_t> &data, const int &repeat, cv::Mat &mat, std::vector<std::string> &label_list_)
+    bool run_model(const std::string &model, const std::vector<cv::Mat> &crops, const std::vector<std::string> &paths, const int &repeat, const std::vector<std::string> &dict, int beam_width)
     {
         // 1. init engine
 #ifdef AXERA_TARGET_CHIP_AX620E
@@ -174,30 +111,64 @@ namespace ax
         SAMPLE_AX_ENGINE_DEAL_HANDLE
         fprintf(stdout, "Engine alloc io is done. \n");
 
-        // 7. insert input
-        ret = middleware::push_input(data, &io_data, io_info);
-        SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
-        fprintf(stdout, "Engine push input is done. \n");
+        // 7. group the lines into batches, input is [batch, h, w, 3] and output [batch, steps, classes]
+        auto &input_info = io_info->pInputs[0];
+        auto &output_info = io_info->pOutputs[0];
+        const int steps = output_info.pShape[1];
+        const int classes = output_info.pShape[2];
+        ocr::WidthBuckets buckets(input_info.pShape[1], {{input_info.pShape[2], input_info.pShape[0]}});
+        ocr::CTCDecoder decoder(dict);
+        auto batches = buckets.plan(crops);
+        fprintf(stdout, "%zu lines in %zu batches of %d. \n", crops.size(), batches.size(), (int)input_info.pShape[0]);
         fprintf(stdout, "--------------------------------------\n");
 
         // 8. warn up
+        std::vector<uint8_t> data;
+        buckets.fill(crops, batches[0], data, PAD_VALUE);
+        ret = middleware::push_input(data, &io_data, io_info);
+        SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
         for (int i = 0; i < 5; ++i)
         {
             AX_ENGINE_RunSync(handle, &io_data);
         }
 
-        // 9. run model
+        // 9. run model and decode every batch
+        std::vector<ocr::TextLine> lines(crops.size()), batch_lines;
+        std::vector<int> valid_steps;
         std::vector<float> time_costs(repeat, 0);
+        float decode_cost = 0.f;
         for (int i = 0; i < repeat; ++i)
         {
-            timer tick;
-            ret = AX_ENGINE_RunSync(handle, &io_data);
-            time_costs[i] = tick.cost();
-            SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
+            decode_cost = 0.f;
+            for (const auto &batch : batches)
+            {
+                buckets.fill(crops, batch, data, PAD_VALUE);
+                ret = middleware::push_input(data, &io_data, io_info);
+                SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
+
+                timer tick;
+                ret = AX_ENGINE_RunSync(handle, &io_data);
+                time_costs[i] += tick.cost();
+                SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
+
+                timer timer_decode;
+                const int count = (int)batch.lines.size();
+                valid_steps.resize(count);
+                for (int j = 0; j < count; j++)
+                {
+                    valid_steps[j] = buckets.valid_steps(batch, j, steps);
+                }
+                decoder.decode((const float *)io_data.pOutputs[0].pVirAddr, count, steps, classes, valid_steps.data(), beam_width, batch_lines);
+                for (int j = 0; j < count; j++)
+                {
+                    lines[batch.lines[j].index] = batch_lines[j];
+                }
+                decode_cost += timer_decode.cost();
+            }
         }
 
         // 10. get result
-        post_process(io_info, &io_data, mat, label_list_, time_costs);
+        post_process(paths, lines, decode_cost, time_costs);
         fprintf(stdout, "--------------------------------------\n");
 
         middleware::free_io(&io_data);
@@ -209,9 +180,10 @@ int main(int argc, char *argv[])
 {
     cmdline::parser cmd;
     cmd.add<std::string>("model", 'm', "joint file(a.k.a. joint model)", true, "");
-    cmd.add<std::string>("image", 'i', "image file", true, "");
+    cmd.add<std::string>("image", 'i', "text line image file", false, "");
+    cmd.add<std::string>("folder", 'f', "folder of text line images", false, "");
     cmd.add<std::string>("dict", 'd', "dict file", true, "");
-    cmd.add<std::string>("size", 'g', "input_h, input_w", false, std::to_string(DEFAULT_IMG_H) + "," + std::to_string(DEFAULT_IMG_W));
+    cmd.add<int>("beam", 'b', "ctc prefix beam width, 0 for greedy decoding", false, DEFAULT_BEAM_WIDTH);
 
     cmd.add<int>("repeat", 'r', "repeat count", false, DEFAULT_LOOP_COUNT);
     cmd.parse_check(argc, argv);
@@ -219,10 +191,11 @@ int main(int argc, char *argv[])
     // 0. get app args, can be removed from user's app
     auto model_file = cmd.get<std::string>("model");
     auto image_file = cmd.get<std::string>("image");
+    auto image_folder = cmd.get<std::string>("folder");
     auto dict_file = cmd.get<std::string>("dict");
 
     auto model_file_flag = utilities::file_exist(model_file);
-    auto image_file_flag = utilities::file_exist(image_file);
+    auto image_file_flag = !image_folder.empty() || utilities::file_exist(image_file);
 
     if (!model_file_flag | !image_file_flag)
     {
@@ -243,58 +216,77 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-    auto input_size_string = cmd.get<std::string>("size");
-
-    std::array<int, 2> input_size = {DEFAULT_IMG_H, DEFAULT_IMG_W};
-
-    auto input_size_flag = utilities::parse_string(input_size_string, input_size);
-
-    if (!input_size_flag)
-    {
-        auto show_error = [](const std::string &kind, const std::string &value)
-        {
-            fprintf(stderr, "Input %s(%s) is not allowed, please check it.\n", kind.c_str(), value.c_str());
-        };
-
-        show_error("size", input_size_string);
-
-        return -1;
-    }
-
     auto repeat = cmd.get<int>("repeat");
+    auto beam_width = cmd.get<int>("beam");
 
     // 1. print args
     fprintf(stdout, "--------------------------------------\n");
     fprintf(stdout, "model file : %s\n", model_file.c_str());
-    fprintf(stdout, "image file : %s\n", image_file.c_str());
+    if (image_folder.empty())
+    {
+        fprintf(stdout, "image file : %s\n", image_file.c_str());
+    }
+    else
+    {
+        fprintf(stdout, "image folder : %s\n", image_folder.c_str());
+    }
     fprintf(stdout, "dict file : %s\n", dict_file.c_str());
-    fprintf(stdout, "img_h, img_w : %d %d\n", input_size[0], input_size[1]);
+    fprintf(stdout, "beam width : %d\n", beam_width);
     fprintf(stdout, "--------------------------------------\n");
 
-    // 2. read image & resize & transpose
-    std::vector<uint8_t> image(input_size[0] * input_size[1] * 3, 0);
-    cv::Mat mat = cv::imread(image_file);
-    if (mat.empty())
+    // 2. read the line crops, they are resized per batch
+    std::vector<std::string> image_list;
+    if (image_folder.empty())
+    {
+        image_list.push_back(image_file);
+    }
+    else
+    {
+        if (image_folder.back() != '/')
+        {
+            image_folder += "/";
+        }
+        for (const char *ext : {"*.jpg", "*.png", "*.jpeg"})
+        {
+            std::vector<std::string> found;
+            cv::glob(image_folder + ext, found);
+            image_list.insert(image_list.end(), found.begin(), found.end());
+        }
+    }
+
+    std::vector<cv::Mat> crops;
+    std::vector<std::string> paths;
+    for (const auto &path : image_list)
     {
-        fprintf(stderr, "Read image failed.\n");
+        cv::Mat mat = cv::imread(path);
+        if (mat.empty())
+        {
+            fprintf(stderr, "Read image(%s) failed.\n", path.c_str());
+            continue;
+        }
+        crops.push_back(mat);
+        paths.push_back(path);
+    }
+    if (crops.empty())
+    {
+        fprintf(stderr, "No text line image.\n");
         return -1;
     }
+
+    std::vector<std::string> dict;
+    if (!ocr::read_dict(dict_file, dict))
     {
-        float height = mat.rows;
-        float width = mat.cols;
-        float ratio = height / DEFAULT_IMG_H;
-        int new_width = width / ratio;
+        fprintf(stderr, "Read dict file(%s) failed.\n", dict_file.c_str());
+        return -1;
     }
-    common::get_input_data_no_letterbox(mat, image, input_size[0], input_size[1]);
 
-    std::vector<std::string> label_list_ = ax::ReadDict(dict_file);
     // 3. sys_init
     AX_SYS_Init();
 
     // 4. -  engine model  -  can only use AX_ENGINE** inside
     {
         // AX_ENGINE_NPUReset(); // todo ??
-        ax::run_model(model_file, image, repeat, mat, label_list_);
+        ax::run_model(model_file, crops, paths, repeat, dict, beam_width);
 
         // 4.3 engine de init
         AX_ENGINE_Deinit();
@@ -118,25 +118,21 @@ namespace ax
         upper_label += sleeve_list[ptr[3] > ptr[2] ? 1 : 0];
         upper_label += " # ";
 
-        float *upper_ptr = ptr + 4;
-        for (size_t i = 0; i < 4; i++)
+        /* the exported model already ends with a sigmoid */
+        std::vector<classification::score> labels;
+        classification::multi_label(ptr + 4, 4, threshold, labels);
+        for (auto &label : labels)
         {
-            if (upper_ptr[i] > threshold)
-            {
-                upper_label += upper_list[i];
-                upper_label += " # ";
-            }
+            upper_label += upper_list[label.id];
+            upper_label += " # ";
         }
 
         std::string lower_label = "";
-        float *lower_ptr = ptr + 8;
-        for (size_t i = 0; i < 6; i++)
+        classification::multi_label(ptr + 8, 6, threshold, labels);
+        for (auto &label : labels)
         {
-            if (lower_ptr[i] > threshold)
-            {
-                lower_label += lower_list[i];
-                lower_label += " # ";
-            }
+            lower_label += lower_list[label.id];
+            lower_label += " # ";
         }
 
         float bag_prob_max_val;
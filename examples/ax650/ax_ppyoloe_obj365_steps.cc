@@ -425,6 +425,8 @@ const int DEFAULT_LOOP_COUNT = 1;
 
 const float PROB_THRESHOLD = 0.75f;
 const float NMS_THRESHOLD = 0.45f;
+const int PRE_NMS_TOPK = 1000;
+const int MAX_DET = 300;
 namespace ax
 {
     //去除grid的后处理方式
@@ -470,7 +472,16 @@ namespace ax
 
         generate_proposals_ppyoloe(proposals, cls_ptr, reg_ptr, PROB_THRESHOLD, num_grid, num_class);
 
-        detection::get_out_bbox(proposals, objects, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols);
+        /* 365 classes: per class NMS spread over a small pool */
+        static utilities::thread_pool nms_pool(4);
+        std::vector<int> picked;
+        detection::batched_nms(proposals, picked, NMS_THRESHOLD, PRE_NMS_TOPK, MAX_DET, detection::NMS_PER_CLASS, nms::NMS_GRID, &nms_pool);
+        objects.reserve(picked.size());
+        for (int i : picked)
+        {
+            objects.push_back(proposals[i]);
+        }
+        detection::get_out_bbox(objects, input_h, input_w, mat.rows, mat.cols);
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
         fprintf(stdout, "--------------------------------------\n");
         auto total_time = std::accumulate(time_costs.begin(), time_costs.end(), 0.f);
@@ -25,6 +25,7 @@
 #include <opencv2/opencv.hpp>
 #include "base/common.hpp"
 #include "base/detection.hpp"
+#include "base/tiling.hpp"
 #include "middleware/io.hpp"
 
 #include "utilities/args.hpp"
@@ -39,24 +40,13 @@ const int DEFAULT_IMG_H = 64;
 const int DEFAULT_IMG_W = 64;
 
 const int DEFAULT_LOOP_COUNT = 1;
+const int DEFAULT_OVERLAP = 8;
 
 namespace ax
 {
-    void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, int input_w, int input_h, const std::vector<float>& time_costs)
+    void post_process(const cv::Mat& dst, int tiles, float post_cost, const std::vector<float>& time_costs)
     {
-        timer timer_postprocess;
-        auto& info = io_info->pOutputs[0];
-        float* output = (float*)io_data->pOutputs[0].pVirAddr;
-
-        cv::Mat dst(info.pShape[1], info.pShape[2], CV_8UC(info.pShape[3]));
-        uchar* dst_data = dst.data;
-        for (size_t i = 0; i < info.nSize / 4; i++)
-        {
-            float val = output[i] * 255.f;
-            dst_data[i] = val > UCHAR_MAX ? UCHAR_MAX : val;
-        }
-
-        fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
+        fprintf(stdout, "%d tiles, post process cost time:%.2f ms \n", tiles, post_cost);
         fprintf(stdout, "--------------------------------------\n");
         auto total_time = std::accumulate(time_costs.begin(), time_costs.end(), 0.f);
         auto min_max_time = std::minmax_element(time_costs.begin(), time_costs.end());
@@ -70,7 +60,7 @@ namespace ax
         cv::imwrite("realesrgan_out.jpg", dst);
     }
 
-    bool run_model(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, cv::Mat& mat, int input_h, int input_w)
+    bool run_model(const std::string& model, const int& repeat, cv::Mat& mat, int input_h, int input_w, int overlap)
     {
         // 1. init engine
 #ifdef AXERA_TARGET_CHIP_AX620E
@@ -117,30 +107,53 @@ namespace ax
         SAMPLE_AX_ENGINE_DEAL_HANDLE
         fprintf(stdout, "Engine alloc io is done. \n");
 
-        // 7. insert input
-        ret = middleware::push_input(data, &io_data, io_info);
-        SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
-        fprintf(stdout, "Engine push input is done. \n");
-        fprintf(stdout, "--------------------------------------\n");
-
-        // 8. warn up
+        // 7. warn up
         for (int i = 0; i < 5; ++i)
         {
             AX_ENGINE_RunSync(handle, &io_data);
         }
 
-        // 9. run model
+        // 8. run the model tile by tile over the whole image, every pass gives one time cost
+        auto& info = io_info->pOutputs[0];
+        const int scale = info.pShape[1] / input_h;
+        cv::Mat dst(mat.rows * scale, mat.cols * scale, CV_8UC3);
+        tiling::TiledUpscaler upscaler(input_w, input_h, scale, overlap);
+
+        int tiles = 0;
+        float infer_cost = 0.f;
+        auto infer = [&](const std::vector<uint8_t>& tile) -> const float* {
+            timer tick;
+            ret = middleware::push_input(tile, &io_data, io_info);
+            if (0 == ret)
+                ret = AX_ENGINE_RunSync(handle, &io_data);
+            if (0 != ret)
+            {
+                fprintf(stderr, "Run tile %d failed.\n", tiles);
+                return nullptr;
+            }
+            infer_cost += tick.cost();
+            tiles++;
+            return (const float*)io_data.pOutputs[0].pVirAddr;
+        };
+        auto sink = [&](int y, const uint8_t* row) {
+            memcpy(dst.ptr<uint8_t>(y), row, (size_t)dst.cols * 3);
+        };
+
         std::vector<float> time_costs(repeat, 0);
+        float post_cost = 0.f;
         for (int i = 0; i < repeat; ++i)
         {
+            tiles = 0;
+            infer_cost = 0.f;
             timer tick;
-            ret = AX_ENGINE_RunSync(handle, &io_data);
-            time_costs[i] = tick.cost();
+            upscaler.run(mat, infer, sink);
             SAMPLE_AX_ENGINE_DEAL_HANDLE_IO
+            time_costs[i] = tick.cost();
+            post_cost = time_costs[i] - infer_cost;
         }
 
-        // 10. get result
-        post_process(io_info, &io_data, mat, input_w, input_h, time_costs);
+        // 9. get result
+        post_process(dst, tiles, post_cost, time_costs);
         fprintf(stdout, "--------------------------------------\n");
 
         middleware::free_io(&io_data);
@@ -156,6 +169,7 @@ int main(int argc, char* argv[])
     cmd.add<std::string>("size", 'g', "input_h, input_w", false, std::to_string(DEFAULT_IMG_H) + "," + std::to_string(DEFAULT_IMG_W));
 
     cmd.add<int>("repeat", 'r', "repeat count", false, DEFAULT_LOOP_COUNT);
+    cmd.add<int>("overlap", 'o', "overlap between tiles in input pixels", false, DEFAULT_OVERLAP);
     cmd.parse_check(argc, argv);
 
     // 0. get app args, can be removed from user's app
@@ -195,6 +209,7 @@ int main(int argc, char* argv[])
     }
 
     auto repeat = cmd.get<int>("repeat");
+    auto overlap = cmd.get<int>("overlap");
 
     // 1. print args
     fprintf(stdout, "--------------------------------------\n");
@@ -203,15 +218,13 @@ int main(int argc, char* argv[])
     fprintf(stdout, "img_h, img_w : %d %d\n", input_size[0], input_size[1]);
     fprintf(stdout, "--------------------------------------\n");
 
-    // 2. read image & resize & transpose
-    std::vector<uint8_t> image(input_size[0] * input_size[1] * 3, 0);
+    // 2. read image, it is cut into model sized tiles at its own resolution
     cv::Mat mat = cv::imread(image_file);
     if (mat.empty())
     {
         fprintf(stderr, "Read image failed.\n");
         return -1;
     }
-    common::get_input_data_letterbox(mat, image, input_size[0], input_size[1]);
 
     // 3. sys_init
     AX_SYS_Init();
@@ -219,7 +232,7 @@ int main(int argc, char* argv[])
     // 4. -  engine model  -  can only use AX_ENGINE** inside
     {
         // AX_ENGINE_NPUReset(); // todo ??
-        ax::run_model(model_file, image, repeat, mat, input_size[0], input_size[1]);
+        ax::run_model(model_file, repeat, mat, input_size[0], input_size[1], overlap);
 
         // 4.3 engine de init
         AX_ENGINE_Deinit();
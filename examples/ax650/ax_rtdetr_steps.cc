@@ -52,6 +52,7 @@ const char* CLASS_NAMES[] = {
 const int DEFAULT_LOOP_COUNT = 1;
 
 const float PROB_THRESHOLD = 0.45f;
+const int MAX_DETECTIONS = 300;
 
 namespace ax
 {
@@ -64,33 +65,28 @@ namespace ax
         float* output_prob = (float*)io_data->pOutputs[0].pVirAddr;
         float* output_bbox = (float*)io_data->pOutputs[1].pVirAddr;
 
-        for (size_t i = 0; i < info.pShape[1]; i++)
+        /* every (query, class) pair competes on raw logits, only the winners go through the sigmoid */
+        const int queries = info.pShape[1];
+        const int classes = io_info->pOutputs[0].pShape[2];
+        const int box_size = io_info->pOutputs[1].pShape[2];
+        query::TopK top(MAX_DETECTIONS);
+        top.clear(detection::unsigmoid(PROB_THRESHOLD));
+        query::select_all(output_prob, queries, classes, classes, top);
+
+        for (const auto& c : top.sorted())
         {
-            int maxid = -1;
-            float maxval = -FLT_MAX;
-            for (size_t j = 0; j < io_info->pOutputs[0].pShape[2]; j++)
-            {
-                if (output_prob[j] > maxval)
-                {
-                    maxval = output_prob[j];
-                    maxid = j;
-                }
-            }
-            maxval = detection::sigmoid(maxval);
-
-            if (maxval > PROB_THRESHOLD)
-            {
-                detection::Object obj;
-                obj.label = maxid;
-                obj.prob = maxval;
-                obj.rect.x = (output_bbox[0] - 0.5 * output_bbox[2]) * input_w;
-                obj.rect.y = (output_bbox[1] - 0.5 * output_bbox[3]) * input_h;
-                obj.rect.width = output_bbox[2] * input_w;
-                obj.rect.height = output_bbox[3] * input_h;
-                objects.push_back(obj);
-            }
-            output_prob += io_info->pOutputs[0].pShape[2];
-            output_bbox += io_info->pOutputs[1].pShape[2];
+            const float prob = detection::sigmoid(c.score);
+            if (prob <= PROB_THRESHOLD)
+                continue;
+            const float* box = output_bbox + (size_t)c.query * box_size;
+            detection::Object obj;
+            obj.label = c.label;
+            obj.prob = prob;
+            obj.rect.x = (box[0] - 0.5 * box[2]) * input_w;
+            obj.rect.y = (box[1] - 0.5 * box[3]) * input_h;
+            obj.rect.width = box[2] * input_w;
+            obj.rect.height = box[3] * input_h;
+            objects.push_back(obj);
         }
 
         detection::get_out_bbox(objects, input_h, input_w, mat.rows, mat.cols);
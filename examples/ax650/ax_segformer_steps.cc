@@ -25,6 +25,7 @@
 #include <opencv2/opencv.hpp>
 #include "base/common.hpp"
 #include "base/detection.hpp"
+#include "base/segmentation.hpp"
 #include "middleware/io.hpp"
 
 #include "utilities/args.hpp"
@@ -52,29 +53,17 @@ namespace ax
 
         int width = input_w / 4;
         int height = input_h / 4;
-        cv::Mat seg(height, width, CV_8UC3);
+        cv::Mat labels(height, width, CV_8UC1);
+        cv::Mat seg;
 
         timer timer_postprocess;
         auto& output = io_data->pOutputs[1];
         auto& info = io_info->pOutputs[1];
         auto seg_data = (int*)output.pVirAddr;
 
-        for (size_t y = 0; y < height; y++)
-        {
-            for (size_t x = 0; x < width; x++)
-            {
-                int idx = seg_data[y * width + x];
-                if (idx < 19)
-                {
-                    seg.at<cv::Vec3b>(y, x) = colors[idx];
-                }
-                else
-                {
-                    seg.at<cv::Vec3b>(y, x) = {0, 0, 0};
-                }
-            }
-        }
-        cv::resize(seg, seg, cv::Size(mat.cols, mat.rows));
+        /* the model emits class indices, colorize them straight at the image size */
+        segmentation::index_map(seg_data, height * width, 19, labels.data);
+        segmentation::Palette(colors, 19).colorize(labels, seg, cv::Size(mat.cols, mat.rows));
 
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
         fprintf(stdout, "--------------------------------------\n");
@@ -66,6 +66,10 @@ namespace ax
     void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const std::vector<image_data_t>& batchdata, int input_w, int input_h, const std::vector<float>& time_costs)
     {
         float prob_threshold_u_sigmoid = -1.0f * (float)std::log((1.0f / PROB_THRESHOLD) - 1.0f);
+        /* one task per head, decoded on all cores */
+        static utilities::thread_pool pool;
+        static detection::DecodeScheduler<detection::Object> scheduler(&pool);
+        std::vector<const float*> feats(io_info->nOutputSize);
         for (size_t b = 0; b < batchdata.size(); b++)
         {
             std::vector<detection::Object> proposals;
@@ -74,12 +78,10 @@ namespace ax
             timer timer_postprocess;
             for (uint32_t i = 0; i < io_info->nOutputSize; ++i)
             {
-                auto& output = io_data->pOutputs[i];
-                float* ptr = (float*)output.pVirAddr;
                 int32_t stride = (1 << i) * 8;
-                ptr += b * (input_w / stride) * (input_h / stride) * 3 * (CLASS_NUM + 5);
-                detection::generate_proposals_yolov5(stride, ptr, PROB_THRESHOLD, proposals, input_w, input_h, ANCHORS, prob_threshold_u_sigmoid, CLASS_NUM);
+                feats[i] = (const float*)io_data->pOutputs[i].pVirAddr + b * (input_w / stride) * (input_h / stride) * 3 * (CLASS_NUM + 5);
             }
+            detection::generate_proposals_yolov5(scheduler, feats.data(), (int)feats.size(), PROB_THRESHOLD, proposals, input_w, input_h, ANCHORS, prob_threshold_u_sigmoid, CLASS_NUM);
 
             detection::get_out_bbox(proposals, objects, NMS_THRESHOLD, input_h, input_w, batchdata[b].mat.rows, batchdata[b].mat.cols);
             fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
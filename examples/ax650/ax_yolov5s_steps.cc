@@ -61,15 +61,16 @@ namespace ax
         std::vector<detection::Object> proposals;
         std::vector<detection::Object> objects;
         float prob_threshold_u_sigmoid = -1.0f * (float)std::log((1.0f / PROB_THRESHOLD) - 1.0f);
+        /* one task per head, decoded on all cores */
+        static utilities::thread_pool pool;
+        static detection::DecodeScheduler<detection::Object> scheduler(&pool);
         timer timer_postprocess;
+        std::vector<const float*> feats(io_info->nOutputSize);
         for (uint32_t i = 0; i < io_info->nOutputSize; ++i)
         {
-            auto& output = io_data->pOutputs[i];
-            auto& info = io_info->pOutputs[i];
-            auto ptr = (float*)output.pVirAddr;
-            int32_t stride = (1 << i) * 8;
-            detection::generate_proposals_yolov5(stride, ptr, PROB_THRESHOLD, proposals, input_w, input_h, ANCHORS, prob_threshold_u_sigmoid);
+            feats[i] = (const float*)io_data->pOutputs[i].pVirAddr;
         }
+        detection::generate_proposals_yolov5(scheduler, feats.data(), (int)feats.size(), PROB_THRESHOLD, proposals, input_w, input_h, ANCHORS, prob_threshold_u_sigmoid);
 
         detection::get_out_bbox(proposals, objects, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols);
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
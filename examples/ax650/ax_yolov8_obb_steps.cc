@@ -58,9 +58,9 @@ namespace ax
         std::vector<detection::Object> objects;
         timer timer_postprocess;
 
-        std::vector<int> strides = { 8, 16, 32 };
-        std::vector<detection::GridAndStride> grid_strides;
-        detection::generate_grids_and_stride(input_w, input_h, strides, grid_strides);
+        static const std::vector<int> strides = { 8, 16, 32 };
+        /* built once per input size */
+        const detection::GridSpan grid_strides = detection::GeometryCache::shared().grids(input_w, input_h, strides);
 
         auto feat_ptr = (float*)io_data->pOutputs[0].pVirAddr;
         detection::obb::generate_proposals_yolov8_obb_native(grid_strides, feat_ptr, PROB_THRESHOLD, proposals, input_w, input_h, NUM_CLASS);
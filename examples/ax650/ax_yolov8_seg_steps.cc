@@ -62,8 +62,10 @@ namespace ax
     void post_process(AX_ENGINE_IO_INFO_T* io_info, AX_ENGINE_IO_T* io_data, const cv::Mat& mat, int input_w, int input_h, const std::vector<float>& time_costs)
     {
         middleware::print_io_info(io_info);
-        std::vector<detection::Object> proposals;
+        detection::ProposalBuffer proposals;
+        proposals.reset(DEFAULT_MASK_PROTO_DIM);
         std::vector<detection::Object> objects;
+        std::vector<mask::BitMask> bitmasks;
         timer timer_postprocess;
         float* output_ptr[3] = {(float*)io_data->pOutputs[0].pVirAddr,      // 1*80*80*144
                                 (float*)io_data->pOutputs[1].pVirAddr,      // 1*40*40*144
@@ -81,7 +83,7 @@ namespace ax
         // 1*32*160*160
         auto mask_proto_ptr = (float*)io_data->pOutputs[6].pVirAddr;
 
-        detection::get_out_bbox_mask(proposals, objects, mask_proto_ptr, DEFAULT_MASK_PROTO_DIM, DEFAULT_MASK_SAMPLE_STRIDE, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols);
+        detection::get_out_bbox_mask(proposals, objects, mask_proto_ptr, DEFAULT_MASK_PROTO_DIM, DEFAULT_MASK_SAMPLE_STRIDE, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols, &bitmasks);
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
         fprintf(stdout, "--------------------------------------\n");
         auto total_time = std::accumulate(time_costs.begin(), time_costs.end(), 0.f);
@@ -95,7 +97,7 @@ namespace ax
         fprintf(stdout, "--------------------------------------\n");
         fprintf(stdout, "detection num: %zu\n", objects.size());
 
-        detection::draw_objects_mask(mat, objects, CLASS_NAMES, COCO_COLORS, "yolov8_seg_out");
+        detection::draw_objects_mask(mat, objects, CLASS_NAMES, COCO_COLORS, "yolov8_seg_out", &bitmasks);
     }
 
     bool run_model(const std::string& model, const std::vector<uint8_t>& data, const int& repeat, cv::Mat& mat, int input_h, int input_w)
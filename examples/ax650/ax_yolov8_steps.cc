@@ -61,13 +61,14 @@ namespace ax
     {
         std::vector<detection::Object> proposals;
         std::vector<detection::Object> objects;
+        /* the three heads, split into row bands, decode on all cores */
+        static utilities::thread_pool pool;
+        static detection::DecodeScheduler<detection::Object> scheduler(&pool);
         timer timer_postprocess;
-        for (int i = 0; i < 3; ++i)
-        {
-            auto feat_ptr = (float*)io_data->pOutputs[i].pVirAddr;
-            int32_t stride = (1 << i) * 8;
-            detection::generate_proposals_yolov8_native(stride, feat_ptr, PROB_THRESHOLD, proposals, input_w, input_h, NUM_CLASS);
-        }
+        const float* feats[3] = {(float*)io_data->pOutputs[0].pVirAddr,
+                                 (float*)io_data->pOutputs[1].pVirAddr,
+                                 (float*)io_data->pOutputs[2].pVirAddr};
+        detection::generate_proposals_yolov8_native(scheduler, feats, 3, PROB_THRESHOLD, proposals, input_w, input_h, NUM_CLASS);
 
         detection::get_out_bbox(proposals, objects, NMS_THRESHOLD, input_h, input_w, mat.rows, mat.cols);
         fprintf(stdout, "post process cost time:%.2f ms \n", timer_postprocess.cost());
@@ -0,0 +1,145 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "base/simd.hpp"
+
+/*
+ * Peak extraction for CenterNet style heads (CenterNet, MonoDLE, CenterPoint):
+ * a cell is an object center when its score is above the threshold and is the
+ * maximum of its 3x3 neighbourhood, i.e. it survives a 3x3 max pool. Cells
+ * below the threshold are rejected four at a time before any neighbour is
+ * read, so on the mostly empty sigmoid maps little more than one compare per
+ * vector is done.
+ */
+namespace centernet
+{
+    enum Layout
+    {
+        LAYOUT_NCHW = 0, /* one plane per class */
+        LAYOUT_NHWC = 1, /* classes of a cell are contiguous */
+    };
+
+    /* |pooled - heat| at most this is a peak, for heads that export their own max pool */
+    static const float POOLED_EPS = 1e-4f;
+
+    struct Peak
+    {
+        uint16_t cls;
+        uint16_t y;
+        uint16_t x;
+        float score;
+    };
+
+    /* peak test of one cell against its 3x3 neighbourhood, `step` apart between cells of the same class */
+    static inline bool is_local_max(const float* cell, int y, int x, int height, int width, int step)
+    {
+        const float v = *cell;
+        const int row = width * step;
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            if (y + dy < 0 || y + dy >= height)
+                continue;
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                if (x + dx < 0 || x + dx >= width || (dx == 0 && dy == 0))
+                    continue;
+                if (cell[dy * row + dx * step] > v)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    namespace detail
+    {
+        /* cell i of the flat buffer, if it is a peak */
+        static inline void test(const float* heat, const float* pooled, size_t i, int height, int width, int classes, Layout layout, float threshold, std::vector<Peak>& out)
+        {
+            const float* gate = pooled ? pooled : heat;
+            if (!(gate[i] > threshold))
+                return;
+
+            int c, y, x, step;
+            if (layout == LAYOUT_NCHW)
+            {
+                const size_t area = (size_t)height * width;
+                c = (int)(i / area);
+                y = (int)(i % area) / width;
+                x = (int)(i % area) % width;
+                step = 1;
+            }
+            else
+            {
+                c = (int)(i % classes);
+                y = (int)(i / classes) / width;
+                x = (int)(i / classes) % width;
+                step = classes;
+            }
+
+            if (pooled ? std::fabs(gate[i] - heat[i]) <= POOLED_EPS : is_local_max(heat + i, y, x, height, width, step))
+                out.push_back({(uint16_t)c, (uint16_t)y, (uint16_t)x, gate[i]});
+        }
+    } // namespace detail
+
+    /*
+     * Peaks of a [classes, height, width] or [height, width, classes] heatmap
+     * scoring above threshold, best first (ties in memory order), at most k of
+     * them (all when k <= 0). With `pooled` the head's own max pool output is
+     * used for the neighbourhood test and as the score, like the reference
+     * implementations do.
+     */
+    static void find_peaks(const float* heat, int height, int width, int classes, Layout layout, float threshold, int k, std::vector<Peak>& out, const float* pooled = nullptr)
+    {
+        out.clear();
+        const size_t n = (size_t)height * width * classes;
+
+        /* the whole tensor is one flat sweep whatever the layout, only hot cells are decoded */
+        size_t i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        const float* gate = pooled ? pooled : heat;
+        const simd::v4f vthreshold = simd::set1(threshold);
+        for (; i + 4 <= n; i += 4)
+        {
+            if (!simd::any_ge(simd::load(gate + i), vthreshold))
+                continue;
+            for (size_t j = i; j < i + 4; j++)
+            {
+                detail::test(heat, pooled, j, height, width, classes, layout, threshold, out);
+            }
+        }
+#endif
+        for (; i < n; i++)
+        {
+            detail::test(heat, pooled, i, height, width, classes, layout, threshold, out);
+        }
+
+        /* stable keeps equal scores in memory order, so the result does not depend on the sort */
+        std::stable_sort(out.begin(), out.end(), [](const Peak& a, const Peak& b) { return a.score > b.score; });
+        if (k > 0 && (int)out.size() > k)
+            out.resize(k);
+    }
+} // namespace centernet
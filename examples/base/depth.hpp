@@ -0,0 +1,244 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cfloat>
+#include <vector>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "base/simd.hpp"
+
+namespace depth
+{
+    /* min / max of n floats */
+    static void min_max(const float* src, int n, float& lo, float& hi)
+    {
+        lo = FLT_MAX;
+        hi = -FLT_MAX;
+        int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        if (n >= 4)
+        {
+            simd::v4f vlo = simd::load(src);
+            simd::v4f vhi = vlo;
+            for (i = 4; i + 4 <= n; i += 4)
+            {
+                simd::v4f v = simd::load(src + i);
+                vlo = simd::min(vlo, v);
+                vhi = simd::max(vhi, v);
+            }
+            lo = -simd::reduce_max(simd::sub(simd::set1(0.f), vlo));
+            hi = simd::reduce_max(vhi);
+        }
+#endif
+        for (; i < n; i++)
+        {
+            lo = std::min(lo, src[i]);
+            hi = std::max(hi, src[i]);
+        }
+    }
+
+    /*
+     * Depth map to color image. The map is normalized to 8 bit indices, then
+     * upsampled bilinearly in fixed point and looked up in a 256 entry colormap
+     * in the same sweep, writing straight into a region of the output canvas.
+     *
+     * With momentum 0 every map is stretched over its own min / max. With
+     * momentum in (0, 1) the range is an exponential average over frames and a
+     * map is normalized with the range known before it, so its min / max are
+     * collected while it is converted and the map is read only once; it also
+     * keeps the colors from flickering in streams.
+     */
+    class DepthVisualizer
+    {
+    public:
+        explicit DepthVisualizer(int colormap = cv::COLORMAP_MAGMA, bool invert = false, float momentum = 0.f)
+            : invert_(invert), momentum_(momentum)
+        {
+            cv::Mat ramp(1, 256, CV_8UC1);
+            for (int i = 0; i < 256; i++)
+            {
+                ramp.data[i] = (uint8_t)i;
+            }
+            cv::Mat colored;
+            cv::applyColorMap(ramp, colored, colormap);
+            for (int i = 0; i < 256; i++)
+            {
+                lut_[i] = colored.ptr<cv::Vec3b>(0)[i];
+            }
+        }
+
+        /* forget the tracked range, e.g. when the stream changes scene */
+        void reset()
+        {
+            has_range_ = false;
+        }
+
+        float low() const
+        {
+            return lo_;
+        }
+
+        float high() const
+        {
+            return hi_;
+        }
+
+        /* renders a CV_32FC1 depth map into canvas(roi), canvas is CV_8UC3 */
+        void render(const cv::Mat& depth, cv::Mat& canvas, const cv::Rect& roi)
+        {
+            render((const float*)depth.data, depth.rows, depth.cols, canvas, roi);
+        }
+
+        void render(const float* depth, int rows, int cols, cv::Mat& canvas, const cv::Rect& roi)
+        {
+            const int n = rows * cols;
+            index_.resize(n);
+
+            float lo, hi;
+            if (momentum_ > 0.f && has_range_)
+            {
+                quantize(depth, n, lo, hi);
+                lo_ = momentum_ * lo_ + (1.f - momentum_) * lo;
+                hi_ = momentum_ * hi_ + (1.f - momentum_) * hi;
+            }
+            else
+            {
+                min_max(depth, n, lo, hi);
+                lo_ = lo;
+                hi_ = hi;
+                has_range_ = true;
+                quantize(depth, n, lo, hi);
+            }
+
+            upsample(rows, cols, canvas, roi);
+        }
+
+    private:
+        /* index = round(255 * (v - lo_) / (hi_ - lo_)), saturated, while tracking the map's own range */
+        void quantize(const float* src, int n, float& lo, float& hi)
+        {
+            const float scale = hi_ > lo_ ? 255.f / (hi_ - lo_) : 0.f;
+            const float a = invert_ ? -scale : scale;
+            const float b = (invert_ ? 255.f : 0.f) - lo_ * a + 0.5f;
+            uint8_t* dst = index_.data();
+
+            lo = FLT_MAX;
+            hi = -FLT_MAX;
+            int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+            if (n >= 4)
+            {
+                const simd::v4f va = simd::set1(a);
+                const simd::v4f vb = simd::set1(b);
+                const simd::v4f zero = simd::set1(0.f);
+                const simd::v4f top = simd::set1(255.f);
+                simd::v4f vlo = simd::load(src);
+                simd::v4f vhi = vlo;
+                float q[4];
+                for (; i + 4 <= n; i += 4)
+                {
+                    simd::v4f v = simd::load(src + i);
+                    vlo = simd::min(vlo, v);
+                    vhi = simd::max(vhi, v);
+                    simd::store(q, simd::min(simd::max(simd::fmadd(v, va, vb), zero), top));
+                    dst[i] = (uint8_t)q[0];
+                    dst[i + 1] = (uint8_t)q[1];
+                    dst[i + 2] = (uint8_t)q[2];
+                    dst[i + 3] = (uint8_t)q[3];
+                }
+                lo = -simd::reduce_max(simd::sub(zero, vlo));
+                hi = simd::reduce_max(vhi);
+            }
+#endif
+            for (; i < n; i++)
+            {
+                lo = std::min(lo, src[i]);
+                hi = std::max(hi, src[i]);
+                dst[i] = (uint8_t)std::min(std::max(src[i] * a + b, 0.f), 255.f);
+            }
+        }
+
+        /* bilinear with 7 bit weights, pixel centers aligned like cv::INTER_LINEAR */
+        void upsample(int rows, int cols, cv::Mat& canvas, const cv::Rect& roi)
+        {
+            const int width = roi.width;
+            const int height = roi.height;
+            if (width <= 0 || height <= 0)
+                return;
+
+            if ((int)x0_.size() != width || map_cols_ != cols)
+            {
+                x0_.resize(width);
+                x1_.resize(width);
+                wx_.resize(width);
+                const float sx = (float)cols / width;
+                for (int x = 0; x < width; x++)
+                {
+                    float fx = std::max((x + 0.5f) * sx - 0.5f, 0.f);
+                    int i0 = std::min((int)fx, cols - 1);
+                    x0_[x] = i0;
+                    x1_[x] = std::min(i0 + 1, cols - 1);
+                    wx_[x] = (int)((fx - i0) * 128.f + 0.5f);
+                }
+                map_cols_ = cols;
+            }
+            row_.resize(cols);
+
+            const float sy = (float)rows / height;
+            for (int y = 0; y < height; y++)
+            {
+                float fy = std::max((y + 0.5f) * sy - 0.5f, 0.f);
+                const int y0 = std::min((int)fy, rows - 1);
+                const int y1 = std::min(y0 + 1, rows - 1);
+                const int wy = (int)((fy - y0) * 128.f + 0.5f);
+                const uint8_t* r0 = index_.data() + (size_t)y0 * cols;
+                const uint8_t* r1 = index_.data() + (size_t)y1 * cols;
+                for (int c = 0; c < cols; c++)
+                {
+                    row_[c] = (uint16_t)(r0[c] * (128 - wy) + r1[c] * wy);
+                }
+
+                cv::Vec3b* dst = canvas.ptr<cv::Vec3b>(roi.y + y) + roi.x;
+                for (int x = 0; x < width; x++)
+                {
+                    const int v = (row_[x0_[x]] * (128 - wx_[x]) + row_[x1_[x]] * wx_[x] + 8192) >> 14;
+                    dst[x] = lut_[v];
+                }
+            }
+        }
+
+        cv::Vec3b lut_[256];
+        bool invert_;
+        float momentum_;
+        bool has_range_ = false;
+        float lo_ = 0.f;
+        float hi_ = 0.f;
+
+        /* buffers reused across frames */
+        std::vector<uint8_t> index_;
+        std::vector<uint16_t> row_;
+        std::vector<int> x0_, x1_, wx_;
+        int map_cols_ = 0;
+    };
+} // namespace depth
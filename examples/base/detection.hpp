@@ -20,12 +20,26 @@
 
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <string>
+#include <type_traits>
+#include <map>
+#include <mutex>
+
+#include "base/simd.hpp"
+#include "base/fast_math.hpp"
+#include "base/nms.hpp"
+#include "base/query.hpp"
+#include "base/quant.hpp"
+#include "base/mask.hpp"
+#include "base/segmentation.hpp"
+#include "utilities/thread_pool.hpp"
+
 namespace detection
 {
     typedef struct
@@ -60,24 +74,276 @@ namespace detection
         cv::Mat affine_trans_mat_inv;
     } PalmObject;
 
+    /*
+     * Plain candidate record for sorting and NMS. Mask coefficients and
+     * keypoints stay in the side arenas of ProposalBuffer at row `index`, so
+     * sort and NMS only move these 28 bytes around.
+     */
+    typedef struct Proposal
+    {
+        cv::Rect_<float> rect;
+        float prob;
+        int label;
+        int index;
+    } Proposal;
+
+    struct ProposalBuffer
+    {
+        std::vector<Proposal> records;
+        std::vector<float> mask_feat; /* mask_dim floats per record */
+        std::vector<float> kps_feat;  /* kps_dim floats per record */
+        int mask_dim = 0;
+        int kps_dim = 0;
+
+        /* call before decoding a frame, keeps the capacity */
+        void reset(int mask_dim_ = 0, int kps_dim_ = 0)
+        {
+            records.clear();
+            mask_feat.clear();
+            kps_feat.clear();
+            mask_dim = mask_dim_;
+            kps_dim = kps_dim_;
+        }
+
+        /* appends a record and its arena rows, returns the record index */
+        int push(float x0, float y0, float x1, float y1, float prob, int label)
+        {
+            int index = (int)records.size();
+            Proposal p;
+            p.rect = cv::Rect_<float>(x0, y0, x1 - x0, y1 - y0);
+            p.prob = prob;
+            p.label = label;
+            p.index = index;
+            records.push_back(p);
+            mask_feat.resize(mask_feat.size() + mask_dim);
+            kps_feat.resize(kps_feat.size() + kps_dim);
+            return index;
+        }
+
+        float* mask_feat_of(int index)
+        {
+            return mask_feat.data() + (size_t)index * mask_dim;
+        }
+
+        const float* mask_feat_of(int index) const
+        {
+            return mask_feat.data() + (size_t)index * mask_dim;
+        }
+
+        float* kps_feat_of(int index)
+        {
+            return kps_feat.data() + (size_t)index * kps_dim;
+        }
+
+        const float* kps_feat_of(int index) const
+        {
+            return kps_feat.data() + (size_t)index * kps_dim;
+        }
+
+        /* Object view of one record for the mapping and drawing helpers */
+        void to_object(const Proposal& p, Object& obj) const
+        {
+            obj.rect = p.rect;
+            obj.label = p.label;
+            obj.prob = p.prob;
+            obj.mask_feat.assign(mask_feat_of(p.index), mask_feat_of(p.index) + mask_dim);
+            obj.kps_feat.assign(kps_feat_of(p.index), kps_feat_of(p.index) + kps_dim);
+        }
+    };
+
+    /*
+     * Letterbox geometry of one (model input, source image) size pair: the
+     * padding and scale that map letterbox coordinates back to the source
+     * image. Build it once per stream resolution and hand it to the decoders
+     * and get_out_* helpers instead of the four sizes.
+     */
+    struct LetterboxTransform
+    {
+        int letterbox_rows = 0;
+        int letterbox_cols = 0;
+        int src_rows = 0;
+        int src_cols = 0;
+        /* size of the resized image inside the letterbox and its offset */
+        int resize_rows = 0;
+        int resize_cols = 0;
+        int pad_x = 0;
+        int pad_y = 0;
+        float ratio_x = 1.f;
+        float ratio_y = 1.f;
+
+        LetterboxTransform() {}
+
+        LetterboxTransform(int letterbox_rows_, int letterbox_cols_, int src_rows_, int src_cols_)
+            : letterbox_rows(letterbox_rows_), letterbox_cols(letterbox_cols_), src_rows(src_rows_), src_cols(src_cols_)
+        {
+            float scale_letterbox;
+            if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
+            {
+                scale_letterbox = letterbox_rows * 1.0 / src_rows;
+            }
+            else
+            {
+                scale_letterbox = letterbox_cols * 1.0 / src_cols;
+            }
+            resize_cols = int(scale_letterbox * src_cols);
+            resize_rows = int(scale_letterbox * src_rows);
+
+            pad_y = (letterbox_rows - resize_rows) / 2;
+            pad_x = (letterbox_cols - resize_cols) / 2;
+
+            ratio_x = (float)src_cols / resize_cols;
+            ratio_y = (float)src_rows / resize_rows;
+        }
+
+        bool matches(int letterbox_rows_, int letterbox_cols_, int src_rows_, int src_cols_) const
+        {
+            return letterbox_rows == letterbox_rows_ && letterbox_cols == letterbox_cols_ && src_rows == src_rows_ && src_cols == src_cols_;
+        }
+
+        float map_x(float x) const
+        {
+            return (x - pad_x) * ratio_x;
+        }
+
+        float map_y(float y) const
+        {
+            return (y - pad_y) * ratio_y;
+        }
+
+        float clip_x(float x) const
+        {
+            return std::max(std::min(x, (float)(src_cols - 1)), 0.f);
+        }
+
+        float clip_y(float y) const
+        {
+            return std::max(std::min(y, (float)(src_rows - 1)), 0.f);
+        }
+
+        /*
+         * letterbox corners to source corners, not clipped yet. IoU does not
+         * change under this mapping, so NMS may run before or after it.
+         */
+        void map_corners(float& x0, float& y0, float& x1, float& y1) const
+        {
+            x0 = map_x(x0);
+            y0 = map_y(y0);
+            x1 = map_x(x1);
+            y1 = map_y(y1);
+        }
+
+        void clip_rect(cv::Rect_<float>& rect) const
+        {
+            float x0 = clip_x(rect.x);
+            float y0 = clip_y(rect.y);
+            float x1 = clip_x(rect.x + rect.width);
+            float y1 = clip_y(rect.y + rect.height);
+            rect = cv::Rect_<float>(x0, y0, x1 - x0, y1 - y0);
+        }
+
+        /* letterbox box to clipped source box */
+        void map_rect(cv::Rect_<float>& rect) const
+        {
+            float x0 = rect.x;
+            float y0 = rect.y;
+            float x1 = rect.x + rect.width;
+            float y1 = rect.y + rect.height;
+            map_corners(x0, y0, x1, y1);
+            rect = cv::Rect_<float>(x0, y0, x1 - x0, y1 - y0);
+            clip_rect(rect);
+        }
+
+        /* not clipped, landmarks may sit outside the image */
+        cv::Point2f map_point(const cv::Point2f& p) const
+        {
+            return cv::Point2f(map_x(p.x), map_y(p.y));
+        }
+
+        /* (x, y, score) triples, positions clipped to the image */
+        void map_kps(float* kps, int num_point) const
+        {
+            for (int j = 0; j < num_point; j++)
+            {
+                kps[j * 3] = clip_x(map_x(kps[j * 3]));
+                kps[j * 3 + 1] = clip_y(map_y(kps[j * 3 + 1]));
+            }
+        }
+    };
+
+    /*
+     * Per-stream state for long running samples. Every buffer only grows, so
+     * after the first frames decoding, sort, NMS and building the Object views
+     * reuse the same memory instead of allocating per frame.
+     */
+    struct PostProcessContext
+    {
+        ProposalBuffer proposals;
+        /* for the decoders that emit Objects (plain detection heads) */
+        std::vector<Object> object_proposals;
+        std::vector<int> picked;
+        std::vector<float> areas;
+        std::vector<Object> objects;
+        /* Objects parked while a frame has fewer results, they keep their vectors */
+        std::vector<Object> spare;
+        LetterboxTransform letterbox;
+
+        /* rebuilt only when the model input or the source resolution changes */
+        const LetterboxTransform& letterbox_for(int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+        {
+            if (!letterbox.matches(letterbox_rows, letterbox_cols, src_rows, src_cols))
+                letterbox = LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols);
+            return letterbox;
+        }
+
+        void resize_objects(int count)
+        {
+            while ((int)objects.size() > count)
+            {
+                spare.push_back(std::move(objects.back()));
+                objects.pop_back();
+            }
+            while ((int)objects.size() < count)
+            {
+                if (spare.empty())
+                {
+                    objects.emplace_back();
+                }
+                else
+                {
+                    objects.push_back(std::move(spare.back()));
+                    spare.pop_back();
+                }
+            }
+        }
+    };
+
+    /* precision follows fast_math::precision(), exact by default */
     static inline float sigmoid(float x)
     {
-        return static_cast<float>(1.f / (1.f + exp(-x)));
+        return fast_math::sigmoid(x);
+    }
+
+    /*
+     * Logit of a probability threshold, so decoders can reject raw scores before
+     * paying for exp(). The cut is loosened a little so rounding never drops a
+     * candidate; survivors are still tested against the probability threshold.
+     */
+    static inline float unsigmoid(float prob)
+    {
+        if (prob <= 0.f)
+            return -FLT_MAX;
+        if (prob >= 1.f)
+            return FLT_MAX;
+        return -std::log(1.f / prob - 1.f) - 1e-4f;
     }
 
+    /* softmax into dst, returns its expectation over the bin index */
     static float softmax(const float* src, float* dst, int length)
     {
-        const float alpha = *std::max_element(src, src + length);
-        float denominator = 0;
+        fast_math::softmax(src, dst, length);
         float dis_sum = 0;
         for (int i = 0; i < length; ++i)
         {
-            dst[i] = exp(src[i] - alpha);
-            denominator += dst[i];
-        }
-        for (int i = 0; i < length; ++i)
-        {
-            dst[i] /= denominator;
             dis_sum += i * dst[i];
         }
         return dis_sum;
@@ -136,19 +402,38 @@ namespace detection
         qsort_descent_inplace(faceobjects, 0, faceobjects.size() - 1);
     }
 
+    /* areas is caller owned scratch, so a reused buffer keeps NMS allocation free */
     template<typename T>
-    static void nms_sorted_bboxes(const std::vector<T>& faceobjects, std::vector<int>& picked, float nms_threshold)
+    static void nms_sorted_bboxes(const std::vector<T>& faceobjects, std::vector<int>& picked, std::vector<float>& areas, float nms_threshold, int nms_engine = nms::NMS_EXHAUSTIVE)
     {
         picked.clear();
 
         const int n = faceobjects.size();
 
-        std::vector<float> areas(n);
+        areas.resize(n);
         for (int i = 0; i < n; i++)
         {
             areas[i] = faceobjects[i].rect.area();
         }
 
+        if (nms_engine == nms::NMS_GRID && nms_threshold >= 0.f)
+        {
+            std::vector<nms::Box> boxes(n);
+            for (int i = 0; i < n; i++)
+            {
+                const cv::Rect_<float>& r = faceobjects[i].rect;
+                boxes[i] = {r.x, r.y, r.x + r.width, r.y + r.height};
+            }
+
+            bool done = nms::greedy_grid(boxes, picked, [&](int i, int j) {
+                float inter_area = intersection_area(faceobjects[i], faceobjects[j]);
+                float union_area = areas[i] + areas[j] - inter_area;
+                return inter_area / union_area > nms_threshold;
+            });
+            if (done)
+                return;
+        }
+
         for (int i = 0; i < n; i++)
         {
             const T& a = faceobjects[i];
@@ -171,7 +456,159 @@ namespace detection
         }
     }
 
-    static void generate_grids_and_stride(const int target_w, const int target_h, std::vector<int>& strides, std::vector<GridAndStride>& grid_strides)
+    template<typename T>
+    static void nms_sorted_bboxes(const std::vector<T>& faceobjects, std::vector<int>& picked, float nms_threshold, int nms_engine = nms::NMS_EXHAUSTIVE)
+    {
+        std::vector<float> areas;
+        nms_sorted_bboxes(faceobjects, picked, areas, nms_threshold, nms_engine);
+    }
+
+    enum
+    {
+        NMS_CLASS_AGNOSTIC = 0, /* one pass, boxes of any class suppress each other */
+        NMS_PER_CLASS = 1,      /* independent pass per label, classes may run on a thread pool */
+        NMS_CLASS_OFFSET = 2,   /* one pass where only equal labels suppress each other, same picks as per class */
+    };
+
+    /*
+     * NMS over unsorted proposals for many-class heads. The best pre_nms_topk
+     * proposals are selected with nth_element instead of a full sort, NMS runs
+     * according to class_mode and the survivors are returned best first, capped
+     * at max_det. picked holds indices into proposals; -1 disables a cap.
+     */
+    template<typename T>
+    static void batched_nms(const std::vector<T>& proposals, std::vector<int>& picked, float nms_threshold, int pre_nms_topk = -1, int max_det = -1,
+                            int class_mode = NMS_PER_CLASS, int nms_engine = nms::NMS_EXHAUSTIVE, utilities::thread_pool* pool = nullptr)
+    {
+        picked.clear();
+
+        /* score descending, index ascending so the order is deterministic */
+        auto better = [&](int a, int b) {
+            return proposals[a].prob > proposals[b].prob || (proposals[a].prob == proposals[b].prob && a < b);
+        };
+
+        std::vector<int> order(proposals.size());
+        for (int i = 0; i < (int)order.size(); i++)
+        {
+            order[i] = i;
+        }
+        if (pre_nms_topk >= 0 && pre_nms_topk < (int)order.size())
+        {
+            std::nth_element(order.begin(), order.begin() + pre_nms_topk, order.end(), better);
+            order.resize(pre_nms_topk);
+        }
+        std::sort(order.begin(), order.end(), better);
+        for (int i : order)
+        {
+            assert(proposals[i].label >= 0);
+        }
+
+        auto to_box = [&](int i) {
+            const cv::Rect_<float>& r = proposals[i].rect;
+            return nms::Box{r.x, r.y, r.x + r.width, r.y + r.height};
+        };
+
+        if (class_mode == NMS_PER_CLASS)
+        {
+            /* stable counting sort by label keeps every class score sorted */
+            int num_class = 0;
+            for (int i : order)
+            {
+                num_class = std::max(num_class, proposals[i].label + 1);
+            }
+            std::vector<int> offsets(num_class + 1, 0);
+            for (int i : order)
+            {
+                offsets[proposals[i].label + 1]++;
+            }
+            for (int c = 0; c < num_class; c++)
+            {
+                offsets[c + 1] += offsets[c];
+            }
+            std::vector<int> grouped(order.size());
+            std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+            for (int i : order)
+            {
+                grouped[cursor[proposals[i].label]++] = i;
+            }
+
+            std::vector<int> classes;
+            for (int c = 0; c < num_class; c++)
+            {
+                if (offsets[c + 1] > offsets[c])
+                    classes.push_back(c);
+            }
+
+            std::vector<std::vector<int> > class_picked(classes.size());
+            auto run_class = [&](int k) {
+                int begin = offsets[classes[k]], end = offsets[classes[k] + 1];
+                std::vector<nms::Box> boxes(end - begin);
+                for (int i = begin; i < end; i++)
+                {
+                    boxes[i - begin] = to_box(grouped[i]);
+                }
+                nms::nms_sorted_boxes(boxes, class_picked[k], nms_threshold, nms_engine);
+                for (int& p : class_picked[k])
+                {
+                    p = grouped[begin + p];
+                }
+            };
+
+            /* small class counts are not worth the wake up */
+            if (pool && classes.size() >= 8)
+            {
+                pool->parallel_for((int)classes.size(), run_class);
+            }
+            else
+            {
+                for (int k = 0; k < (int)classes.size(); k++)
+                {
+                    run_class(k);
+                }
+            }
+
+            for (const auto& p : class_picked)
+            {
+                picked.insert(picked.end(), p.begin(), p.end());
+            }
+            std::sort(picked.begin(), picked.end(), better);
+        }
+        else
+        {
+            std::vector<nms::Box> boxes(order.size());
+            for (int i = 0; i < (int)order.size(); i++)
+            {
+                boxes[i] = to_box(order[i]);
+            }
+
+            /*
+             * IoU stays in the original coordinates, shifting boxes apart by label
+             * would cost float precision once label * extent gets large
+             */
+            std::vector<int> labels;
+            if (class_mode == NMS_CLASS_OFFSET)
+            {
+                labels.resize(order.size());
+                for (int i = 0; i < (int)order.size(); i++)
+                {
+                    labels[i] = proposals[order[i]].label;
+                }
+            }
+
+            nms::nms_sorted_boxes(boxes, picked, nms_threshold, nms_engine, labels.empty() ? nullptr : labels.data());
+            for (int& p : picked)
+            {
+                p = order[p];
+            }
+        }
+
+        if (max_det >= 0 && (int)picked.size() > max_det)
+        {
+            picked.resize(max_det);
+        }
+    }
+
+    static void generate_grids_and_stride(const int target_w, const int target_h, const std::vector<int>& strides, std::vector<GridAndStride>& grid_strides)
     {
         for (auto stride : strides)
         {
@@ -191,6 +628,134 @@ namespace detection
         }
     }
 
+    /*
+     * Read only view of a cached grid table. Entry i is cell (grid0, grid1) of
+     * its stride level; center_x / center_y / stride hold (grid + 0.5) * stride
+     * and the stride as plain float arrays so decoders can use vector loads.
+     */
+    typedef struct GridSpan
+    {
+        const GridAndStride* grids = nullptr;
+        const float* center_x = nullptr;
+        const float* center_y = nullptr;
+        const float* stride = nullptr;
+        int size = 0;
+    } GridSpan;
+
+    /* read only view of a cached point table, x / y interleaved */
+    typedef struct PointSpan
+    {
+        const float* points = nullptr;
+        int size = 0; /* number of points */
+    } PointSpan;
+
+    /*
+     * Tables that only depend on the model geometry, built on the first request
+     * for a key and then handed out as spans. Entries are never erased, so a
+     * span stays valid for the lifetime of the cache.
+     */
+    class GeometryCache
+    {
+    public:
+        /* every stride level in order, same layout as generate_grids_and_stride */
+        GridSpan grids(int input_w, int input_h, const std::vector<int>& strides)
+        {
+            std::vector<int> key = {input_w, input_h};
+            key.insert(key.end(), strides.begin(), strides.end());
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_grids.find(key);
+            if (it == m_grids.end())
+            {
+                GridTable table;
+                generate_grids_and_stride(input_w, input_h, strides, table.grids);
+                for (const GridAndStride& gs : table.grids)
+                {
+                    table.center_x.push_back((gs.grid0 + 0.5f) * gs.stride);
+                    table.center_y.push_back((gs.grid1 + 0.5f) * gs.stride);
+                    table.stride.push_back((float)gs.stride);
+                }
+                it = m_grids.emplace(key, std::move(table)).first;
+            }
+
+            const GridTable& table = it->second;
+            GridSpan span;
+            span.grids = table.grids.data();
+            span.center_x = table.center_x.data();
+            span.center_y = table.center_y.data();
+            span.stride = table.stride.data();
+            span.size = (int)table.grids.size();
+            return span;
+        }
+
+        /*
+         * P2PNet (crowdcount) point anchors: row x line points per cell of each
+         * pyramid level 2^l, cells ordered row major, levels concatenated.
+         */
+        PointSpan anchor_points(int input_w, int input_h, const std::vector<int>& pyramid_levels, int row, int line)
+        {
+            std::vector<int> key = {input_w, input_h, row, line};
+            key.insert(key.end(), pyramid_levels.begin(), pyramid_levels.end());
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_points.find(key);
+            if (it == m_points.end())
+            {
+                std::vector<float> points;
+                for (int level : pyramid_levels)
+                {
+                    const int stride = 1 << level;
+                    const int feat_w = (input_w + stride - 1) / stride;
+                    const int feat_h = (input_h + stride - 1) / stride;
+                    const float row_step = (float)stride / row;
+                    const float line_step = (float)stride / line;
+                    for (int h = 0; h < feat_h; h++)
+                    {
+                        for (int w = 0; w < feat_w; w++)
+                        {
+                            const float shift_x = (w + 0.5) * stride;
+                            const float shift_y = (h + 0.5) * stride;
+                            for (int r = 0; r < row; r++)
+                            {
+                                for (int c = 0; c < line; c++)
+                                {
+                                    points.push_back((float)((c + 0.5) * line_step - stride / 2) + shift_x);
+                                    points.push_back((float)((r + 0.5) * row_step - stride / 2) + shift_y);
+                                }
+                            }
+                        }
+                    }
+                }
+                it = m_points.emplace(key, std::move(points)).first;
+            }
+
+            PointSpan span;
+            span.points = it->second.data();
+            span.size = (int)it->second.size() / 2;
+            return span;
+        }
+
+        /* process wide instance for samples that don't keep their own */
+        static GeometryCache& shared()
+        {
+            static GeometryCache cache;
+            return cache;
+        }
+
+    private:
+        struct GridTable
+        {
+            std::vector<GridAndStride> grids;
+            std::vector<float> center_x;
+            std::vector<float> center_y;
+            std::vector<float> stride;
+        };
+
+        std::mutex m_mutex;
+        std::map<std::vector<int>, GridTable> m_grids;
+        std::map<std::vector<int>, std::vector<float> > m_points;
+    };
+
     static void generate_proposals_scrfd(int feat_stride, const float* score_blob,
                                          const float* bbox_blob, const float* kps_blob,
                                          float prob_threshold, std::vector<detection::Object>& faceobjects, int letterbox_cols, int letterbox_rows)
@@ -209,6 +774,7 @@ namespace detection
 
         // generate face proposal from bbox deltas and shifted anchors
         const int num_anchors = 2;
+        const float prob_threshold_unsigmoid = unsigmoid(prob_threshold);
 
         for (int q = 0; q < num_anchors; q++)
         {
@@ -226,7 +792,8 @@ namespace detection
                 {
                     int index = i * feat_w + j;
 
-                    float prob = sigmoid(score_blob[q * feat_size + index]);
+                    float score = score_blob[q * feat_size + index];
+                    float prob = score < prob_threshold_unsigmoid ? 0.f : sigmoid(score);
 
                     if (prob >= prob_threshold)
                     {
@@ -283,6 +850,7 @@ namespace detection
         auto ptr_score = score;
         auto ptr_boxes = boxes;
         auto ptr_anchor_info = anchor_info;
+        const float prob_threshold_log = prob_threshold > 0.f ? std::log(prob_threshold) - 1e-4f : -FLT_MAX;
         for (int head = 0; head < head_count; ++head)
         {
             for (int fea_h = 0; fea_h < feature_map_size[head]; ++fea_h)
@@ -296,11 +864,16 @@ namespace detection
                         int class_index = 0;
                         for (int s = 0; s < cls_num + 1; s++)
                         {
-                            softmax_sum += std::exp(ptr_score[s]);
+                            softmax_sum += fast_math::exp(ptr_score[s]);
                         }
+                        /* exp(s) / sum >= t  <=>  s >= log(t) + log(sum) */
+                        const float score_threshold = prob_threshold_log + fast_math::log(softmax_sum);
                         for (int i = 0; i < cls_num + 1; ++i)
                         {
-                            float temp = std::exp(ptr_score[i]) / softmax_sum;
+                            if (ptr_score[i] < score_threshold)
+                                continue;
+
+                            float temp = fast_math::exp(ptr_score[i]) / softmax_sum;
                             //                            if (temp > class_score)
                             //                            {
                             //                                class_index = i;
@@ -316,8 +889,8 @@ namespace detection
 
                                 float pred_x = (((float)fea_w + 0.5f) / (300.0f / strides[head]) + ptr_boxes[0] * center_val * ptr_anchor_info[anchor_i * 2] / 300.0f);
                                 float pred_y = (((float)fea_h + 0.5f) / (300.0f / strides[head]) + ptr_boxes[1] * center_val * ptr_anchor_info[anchor_i * 2 + 1] / 300.0f);
-                                float pred_w = std::exp(ptr_boxes[2] * scale_val) * ptr_anchor_info[anchor_i * 2] / 300.0f;
-                                float pred_h = std::exp(ptr_boxes[3] * scale_val) * ptr_anchor_info[anchor_i * 2 + 1] / 300.0f;
+                                float pred_w = fast_math::exp(ptr_boxes[2] * scale_val) * ptr_anchor_info[anchor_i * 2] / 300.0f;
+                                float pred_h = fast_math::exp(ptr_boxes[3] * scale_val) * ptr_anchor_info[anchor_i * 2 + 1] / 300.0f;
 
                                 float x0 = (pred_x - pred_w * 0.5f) * 300.0f;
                                 float y0 = (pred_y - pred_h * 0.5f) * 300.0f;
@@ -383,8 +956,8 @@ namespace detection
                 {
                     float x_center = (feat_ptr[0] + w) * stride;
                     float y_center = (feat_ptr[1] + h) * stride;
-                    float w = exp(feat_ptr[2]) * stride;
-                    float h = exp(feat_ptr[3]) * stride;
+                    float w = fast_math::exp(feat_ptr[2]) * stride;
+                    float h = fast_math::exp(feat_ptr[3]) * stride;
                     float x0 = x_center - w * 0.5f;
                     float y0 = y_center - h * 0.5f;
 
@@ -465,418 +1038,200 @@ namespace detection
             }
         }
     }
-    static void generate_proposals_yolov5_face(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
-                                               int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid)
+    enum
     {
-        int anchor_num = 3;
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int cls_num = 1;
-        int anchor_group;
-        if (stride == 8)
-            anchor_group = 1;
-        if (stride == 16)
-            anchor_group = 2;
-        if (stride == 32)
-            anchor_group = 3;
-
-        auto feature_ptr = feat;
-
-        for (int h = 0; h <= feat_h - 1; h++)
+        ANCHOR_LAYOUT_HWA = 0, /* [h][w][anchor][record], the permuted yolov5/yolov7 export */
+        ANCHOR_LAYOUT_AHW = 1, /* [anchor][h][w][record], the raw conv output */
+    };
+
+    /*
+     * Shared decoder of the anchor based yolov5/yolov7 heads, 3 anchors per cell.
+     * Each record is [x, y, w, h, obj, ...] followed by the class scores and then a
+     * tail of TAIL_LEN floats (mask coeffs, CLASS_FIRST = true) or by the tail and
+     * then the class scores (landmarks, CLASS_FIRST = false).
+     * CLS_NUM = 0 / TAIL_LEN = -1 fall back to the run time cls_num / tail_len.
+     * emit(obj, record, w, h, anchor_w, anchor_h) gets the decoded box plus the raw
+     * record so every family only has to fill in its own tail.
+     */
+    template<int CLS_NUM, int TAIL_LEN, bool CLASS_FIRST, int LAYOUT, typename Emit>
+    static void generate_proposals_anchor(int stride, const float* feat, float prob_threshold, float prob_threshold_unsigmoid,
+                                          int letterbox_cols, int letterbox_rows, const float* anchors, int cls_num, int tail_len, Emit emit)
+    {
+        const int anchor_num = 3;
+        const int num_class = CLS_NUM > 0 ? CLS_NUM : cls_num;
+        const int num_tail = TAIL_LEN >= 0 ? TAIL_LEN : tail_len;
+        const int record_len = 5 + num_class + num_tail;
+        const int cls_offset = CLASS_FIRST ? 5 : 5 + num_tail;
+        const int feat_w = letterbox_cols / stride;
+        const int feat_h = letterbox_rows / stride;
+
+        /* stride 8/16/32/64 -> anchor group 0/1/2/3 */
+        int anchor_group = 0;
+        while ((8 << anchor_group) < stride)
+            anchor_group++;
+        const float* anchor_ptr = anchors + anchor_group * anchor_num * 2;
+
+        /* sigmoid(obj) * sigmoid(cls) >= t needs both logits above unsigmoid(t) */
+        const float reject_unsigmoid = std::max(prob_threshold_unsigmoid, unsigmoid(prob_threshold));
+
+        auto decode = [&](const float* ptr, int w, int h, int a) {
+            if (ptr[4] < reject_unsigmoid)
+                return;
+
+            //process cls score
+            float class_score;
+            int class_index = simd::argmax(ptr + cls_offset, num_class, &class_score);
+            if (class_score < reject_unsigmoid)
+                return;
+
+            //process box score
+            float final_score = sigmoid(ptr[4]) * sigmoid(class_score);
+            if (final_score < prob_threshold)
+                return;
+
+            float dx = sigmoid(ptr[0]);
+            float dy = sigmoid(ptr[1]);
+            float dw = sigmoid(ptr[2]);
+            float dh = sigmoid(ptr[3]);
+            float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
+            float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
+            float anchor_w = anchor_ptr[a * 2 + 0];
+            float anchor_h = anchor_ptr[a * 2 + 1];
+            float pred_w = dw * dw * 4.0f * anchor_w;
+            float pred_h = dh * dh * 4.0f * anchor_h;
+            float x0 = pred_cx - pred_w * 0.5f;
+            float y0 = pred_cy - pred_h * 0.5f;
+            float x1 = pred_cx + pred_w * 0.5f;
+            float y1 = pred_cy + pred_h * 0.5f;
+
+            Object obj;
+            obj.rect.x = x0;
+            obj.rect.y = y0;
+            obj.rect.width = x1 - x0;
+            obj.rect.height = y1 - y0;
+            obj.label = class_index;
+            obj.prob = final_score;
+            emit(obj, ptr, w, h, anchor_w, anchor_h);
+        };
+
+        /* walk the tensor in memory order so the feature pointer only moves forward */
+        const float* feature_ptr = feat;
+        if (LAYOUT == ANCHOR_LAYOUT_HWA)
         {
-            for (int w = 0; w <= feat_w - 1; w++)
+            for (int h = 0; h < feat_h; h++)
             {
-                for (int a = 0; a <= anchor_num - 1; a++)
+                for (int w = 0; w < feat_w; w++)
                 {
-                    if (feature_ptr[4] < prob_threshold_unsigmoid)
-                    {
-                        feature_ptr += (cls_num + 5 + 10);
-                        continue;
-                    }
-
-                    //process cls score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    for (int s = 0; s <= cls_num - 1; s++)
+                    for (int a = 0; a < anchor_num; a++)
                     {
-                        float score = feature_ptr[s + 5 + 10];
-                        if (score > class_score)
-                        {
-                            class_index = s;
-                            class_score = score;
-                        }
+                        decode(feature_ptr, w, h, a);
+                        feature_ptr += record_len;
                     }
-                    //process box score
-                    float box_score = feature_ptr[4];
-                    float final_score = sigmoid(box_score) * sigmoid(class_score);
-
-                    if (final_score >= prob_threshold)
+                }
+            }
+        }
+        else
+        {
+            for (int a = 0; a < anchor_num; a++)
+            {
+                for (int h = 0; h < feat_h; h++)
+                {
+                    for (int w = 0; w < feat_w; w++)
                     {
-                        float dx = sigmoid(feature_ptr[0]);
-                        float dy = sigmoid(feature_ptr[1]);
-                        float dw = sigmoid(feature_ptr[2]);
-                        float dh = sigmoid(feature_ptr[3]);
-                        float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
-                        float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
-                        float anchor_w = anchors[(anchor_group - 1) * 6 + a * 2 + 0];
-                        float anchor_h = anchors[(anchor_group - 1) * 6 + a * 2 + 1];
-                        float pred_w = dw * dw * 4.0f * anchor_w;
-                        float pred_h = dh * dh * 4.0f * anchor_h;
-                        float x0 = pred_cx - pred_w * 0.5f;
-                        float y0 = pred_cy - pred_h * 0.5f;
-                        float x1 = pred_cx + pred_w * 0.5f;
-                        float y1 = pred_cy + pred_h * 0.5f;
-
-                        Object obj;
-                        obj.rect.x = x0;
-                        obj.rect.y = y0;
-                        obj.rect.width = x1 - x0;
-                        obj.rect.height = y1 - y0;
-                        obj.label = class_index;
-                        obj.prob = final_score;
-
-                        const float* landmark_ptr = feature_ptr + 5;
-                        for (int l = 0; l < 5; l++)
-                        {
-                            float lx = landmark_ptr[l * 2 + 0];
-                            float ly = landmark_ptr[l * 2 + 1];
-                            lx = lx * anchor_w + w * stride;
-                            ly = ly * anchor_h + h * stride;
-                            obj.landmark[l] = cv::Point2f(lx, ly);
-                        }
-
-                        objects.push_back(obj);
+                        decode(feature_ptr, w, h, a);
+                        feature_ptr += record_len;
                     }
-
-                    feature_ptr += (cls_num + 5 + 10);
                 }
             }
         }
     }
 
-    static void generate_proposals_yolov5_license_plate(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
-                                                        int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid)
+    static void generate_proposals_yolov5_face(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
+                                               int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid)
     {
-        int anchor_num = 3;
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int cls_num = 1;
-        int anchor_group;
-        if (stride == 8)
-            anchor_group = 1;
-        if (stride == 16)
-            anchor_group = 2;
-        if (stride == 32)
-            anchor_group = 3;
-
-        auto feature_ptr = feat;
-
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                for (int a = 0; a <= anchor_num - 1; a++)
+        /* [box, obj, 5 landmarks, cls] */
+        generate_proposals_anchor<1, 10, false, ANCHOR_LAYOUT_HWA>(
+            stride, feat, prob_threshold, prob_threshold_unsigmoid, letterbox_cols, letterbox_rows, anchors, 1, 10,
+            [&](Object& obj, const float* ptr, int w, int h, float anchor_w, float anchor_h) {
+                const float* landmark_ptr = ptr + 5;
+                for (int l = 0; l < 5; l++)
                 {
-                    if (feature_ptr[4] < prob_threshold_unsigmoid)
-                    {
-                        feature_ptr += (cls_num + 5 + 8);
-                        continue;
-                    }
-
-                    //process cls score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    for (int s = 0; s <= cls_num - 1; s++)
-                    {
-                        float score = feature_ptr[s + 5 + 8];
-                        if (score > class_score)
-                        {
-                            class_index = s;
-                            class_score = score;
-                        }
-                    }
-                    //process box score
-                    float box_score = feature_ptr[4];
-                    float final_score = sigmoid(box_score) * sigmoid(class_score);
-
-                    if (final_score >= prob_threshold)
-                    {
-                        float dx = sigmoid(feature_ptr[0]);
-                        float dy = sigmoid(feature_ptr[1]);
-                        float dw = sigmoid(feature_ptr[2]);
-                        float dh = sigmoid(feature_ptr[3]);
-                        float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
-                        float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
-                        float anchor_w = anchors[(anchor_group - 1) * 6 + a * 2 + 0];
-                        float anchor_h = anchors[(anchor_group - 1) * 6 + a * 2 + 1];
-                        float pred_w = dw * dw * 4.0f * anchor_w;
-                        float pred_h = dh * dh * 4.0f * anchor_h;
-                        float x0 = pred_cx - pred_w * 0.5f;
-                        float y0 = pred_cy - pred_h * 0.5f;
-                        float x1 = pred_cx + pred_w * 0.5f;
-                        float y1 = pred_cy + pred_h * 0.5f;
-
-                        Object obj;
-                        obj.rect.x = x0;
-                        obj.rect.y = y0;
-                        obj.rect.width = x1 - x0;
-                        obj.rect.height = y1 - y0;
-                        obj.label = class_index;
-                        obj.prob = final_score;
-
-                        const float* landmark_ptr = feature_ptr + 5;
-                        for (int l = 0; l < 4; l++)
-                        {
-                            float lx = landmark_ptr[l * 2 + 0];
-                            float ly = landmark_ptr[l * 2 + 1];
-                            lx = lx * anchor_w + w * stride;
-                            ly = ly * anchor_h + h * stride;
-                            obj.landmark[l] = cv::Point2f(lx, ly);
-                        }
-
-                        objects.push_back(obj);
-                    }
-
-                    feature_ptr += (cls_num + 5 + 8);
+                    float lx = landmark_ptr[l * 2 + 0];
+                    float ly = landmark_ptr[l * 2 + 1];
+                    lx = lx * anchor_w + w * stride;
+                    ly = ly * anchor_h + h * stride;
+                    obj.landmark[l] = cv::Point2f(lx, ly);
                 }
-            }
-        }
+                objects.push_back(obj);
+            });
     }
 
-    static void generate_proposals_yolov5(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
-                                          int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid, int cls_num = 80)
+    static void generate_proposals_yolov5_license_plate(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
+                                                        int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid)
     {
-        int anchor_num = 3;
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int anchor_group;
-        if (stride == 8)
-            anchor_group = 1;
-        if (stride == 16)
-            anchor_group = 2;
-        if (stride == 32)
-            anchor_group = 3;
-
-        auto feature_ptr = feat;
-
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                for (int a = 0; a <= anchor_num - 1; a++)
+        /* [box, obj, 4 corners, cls] */
+        generate_proposals_anchor<1, 8, false, ANCHOR_LAYOUT_HWA>(
+            stride, feat, prob_threshold, prob_threshold_unsigmoid, letterbox_cols, letterbox_rows, anchors, 1, 8,
+            [&](Object& obj, const float* ptr, int w, int h, float anchor_w, float anchor_h) {
+                const float* landmark_ptr = ptr + 5;
+                for (int l = 0; l < 4; l++)
                 {
-                    if (feature_ptr[4] < prob_threshold_unsigmoid)
-                    {
-                        feature_ptr += (cls_num + 5);
-                        continue;
-                    }
-
-                    //process cls score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    for (int s = 0; s <= cls_num - 1; s++)
-                    {
-                        float score = feature_ptr[s + 5];
-                        if (score > class_score)
-                        {
-                            class_index = s;
-                            class_score = score;
-                        }
-                    }
-                    //process box score
-                    float box_score = feature_ptr[4];
-                    float final_score = sigmoid(box_score) * sigmoid(class_score);
-
-                    if (final_score >= prob_threshold)
-                    {
-                        float dx = sigmoid(feature_ptr[0]);
-                        float dy = sigmoid(feature_ptr[1]);
-                        float dw = sigmoid(feature_ptr[2]);
-                        float dh = sigmoid(feature_ptr[3]);
-                        float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
-                        float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
-                        float anchor_w = anchors[(anchor_group - 1) * 6 + a * 2 + 0];
-                        float anchor_h = anchors[(anchor_group - 1) * 6 + a * 2 + 1];
-                        float pred_w = dw * dw * 4.0f * anchor_w;
-                        float pred_h = dh * dh * 4.0f * anchor_h;
-                        float x0 = pred_cx - pred_w * 0.5f;
-                        float y0 = pred_cy - pred_h * 0.5f;
-                        float x1 = pred_cx + pred_w * 0.5f;
-                        float y1 = pred_cy + pred_h * 0.5f;
-
-                        Object obj;
-                        obj.rect.x = x0;
-                        obj.rect.y = y0;
-                        obj.rect.width = x1 - x0;
-                        obj.rect.height = y1 - y0;
-                        obj.label = class_index;
-                        obj.prob = final_score;
-                        objects.push_back(obj);
-                    }
-
-                    feature_ptr += (cls_num + 5);
+                    float lx = landmark_ptr[l * 2 + 0];
+                    float ly = landmark_ptr[l * 2 + 1];
+                    lx = lx * anchor_w + w * stride;
+                    ly = ly * anchor_h + h * stride;
+                    obj.landmark[l] = cv::Point2f(lx, ly);
                 }
-            }
-        }
+                objects.push_back(obj);
+            });
+    }
+
+    static void generate_proposals_yolov5(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
+                                          int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid, int cls_num = 80,
+                                          const LetterboxTransform* lb = nullptr)
+    {
+        /* with lb the boxes come out in source coordinates, see generate_proposals_yolov8_native */
+        auto emit = [&](Object& obj, const float*, int, int, float, float) {
+            if (lb)
+                obj.rect = cv::Rect_<float>(lb->map_x(obj.rect.x), lb->map_y(obj.rect.y), obj.rect.width * lb->ratio_x, obj.rect.height * lb->ratio_y);
+            objects.push_back(obj);
+        };
+        if (cls_num == 80)
+            generate_proposals_anchor<80, 0, true, ANCHOR_LAYOUT_HWA>(stride, feat, prob_threshold, prob_threshold_unsigmoid,
+                                                                      letterbox_cols, letterbox_rows, anchors, cls_num, 0, emit);
+        else
+            generate_proposals_anchor<0, 0, true, ANCHOR_LAYOUT_HWA>(stride, feat, prob_threshold, prob_threshold_unsigmoid,
+                                                                     letterbox_cols, letterbox_rows, anchors, cls_num, 0, emit);
     }
 
     static void generate_proposals_yolov5_seg(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
                                               int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid, int cls_num = 80, int mask_proto_dim = 32)
     {
-        int anchor_num = 3;
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int anchor_group;
-        if (stride == 8)
-            anchor_group = 1;
-        if (stride == 16)
-            anchor_group = 2;
-        if (stride == 32)
-            anchor_group = 3;
-
-        auto feature_ptr = feat;
-
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                for (int a = 0; a <= anchor_num - 1; a++)
-                {
-                    if (feature_ptr[4] < prob_threshold_unsigmoid)
-                    {
-                        feature_ptr += (cls_num + 5 + mask_proto_dim);
-                        continue;
-                    }
-
-                    //process cls score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    for (int s = 0; s <= cls_num - 1; s++)
-                    {
-                        float score = feature_ptr[s + 5];
-                        if (score > class_score)
-                        {
-                            class_index = s;
-                            class_score = score;
-                        }
-                    }
-                    //process box score
-                    float box_score = feature_ptr[4];
-                    float final_score = sigmoid(box_score) * sigmoid(class_score);
-
-                    if (final_score >= prob_threshold)
-                    {
-                        float dx = sigmoid(feature_ptr[0]);
-                        float dy = sigmoid(feature_ptr[1]);
-                        float dw = sigmoid(feature_ptr[2]);
-                        float dh = sigmoid(feature_ptr[3]);
-                        float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
-                        float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
-                        float anchor_w = anchors[(anchor_group - 1) * 6 + a * 2 + 0];
-                        float anchor_h = anchors[(anchor_group - 1) * 6 + a * 2 + 1];
-                        float pred_w = dw * dw * 4.0f * anchor_w;
-                        float pred_h = dh * dh * 4.0f * anchor_h;
-                        float x0 = pred_cx - pred_w * 0.5f;
-                        float y0 = pred_cy - pred_h * 0.5f;
-                        float x1 = pred_cx + pred_w * 0.5f;
-                        float y1 = pred_cy + pred_h * 0.5f;
-
-                        Object obj;
-                        obj.rect.x = x0;
-                        obj.rect.y = y0;
-                        obj.rect.width = x1 - x0;
-                        obj.rect.height = y1 - y0;
-                        obj.label = class_index;
-                        obj.prob = final_score;
-                        obj.mask_feat.resize(mask_proto_dim);
-                        for (int k = 0; k < mask_proto_dim; k++)
-                        {
-                            obj.mask_feat[k] = feature_ptr[cls_num + 5 + k];
-                        }
-                        objects.push_back(obj);
-                    }
-
-                    feature_ptr += (cls_num + 5 + mask_proto_dim);
-                }
-            }
-        }
+        /* [box, obj, cls, mask coeffs] */
+        auto emit = [&](Object& obj, const float* ptr, int, int, float, float) {
+            obj.mask_feat.assign(ptr + 5 + cls_num, ptr + 5 + cls_num + mask_proto_dim);
+            objects.push_back(obj);
+        };
+        if (cls_num == 80 && mask_proto_dim == 32)
+            generate_proposals_anchor<80, 32, true, ANCHOR_LAYOUT_HWA>(stride, feat, prob_threshold, prob_threshold_unsigmoid,
+                                                                       letterbox_cols, letterbox_rows, anchors, cls_num, mask_proto_dim, emit);
+        else
+            generate_proposals_anchor<0, -1, true, ANCHOR_LAYOUT_HWA>(stride, feat, prob_threshold, prob_threshold_unsigmoid,
+                                                                      letterbox_cols, letterbox_rows, anchors, cls_num, mask_proto_dim, emit);
     }
 
     static void generate_proposals_yolov5_visdrone(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
                                                    int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid, int cls_num = 10)
     {
-        int anchor_num = 3;
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int anchor_group;
-        if (stride == 8)
-            anchor_group = 1;
-        if (stride == 16)
-            anchor_group = 2;
-        if (stride == 32)
-            anchor_group = 3;
-
-        auto feature_ptr = feat;
-
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                for (int a = 0; a <= anchor_num - 1; a++)
-                {
-                    if (feature_ptr[4] < prob_threshold_unsigmoid)
-                    {
-                        feature_ptr += (cls_num + 5);
-                        continue;
-                    }
-
-                    //process cls score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    for (int s = 0; s <= cls_num - 1; s++)
-                    {
-                        float score = feature_ptr[s + 5];
-                        if (score > class_score)
-                        {
-                            class_index = s;
-                            class_score = score;
-                        }
-                    }
-                    //process box score
-                    float box_score = feature_ptr[4];
-                    float final_score = sigmoid(box_score) * sigmoid(class_score);
-
-                    if (final_score >= prob_threshold)
-                    {
-                        float dx = sigmoid(feature_ptr[0]);
-                        float dy = sigmoid(feature_ptr[1]);
-                        float dw = sigmoid(feature_ptr[2]);
-                        float dh = sigmoid(feature_ptr[3]);
-                        float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
-                        float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
-                        float anchor_w = anchors[(anchor_group - 1) * 6 + a * 2 + 0];
-                        float anchor_h = anchors[(anchor_group - 1) * 6 + a * 2 + 1];
-                        float pred_w = dw * dw * 4.0f * anchor_w;
-                        float pred_h = dh * dh * 4.0f * anchor_h;
-                        float x0 = pred_cx - pred_w * 0.5f;
-                        float y0 = pred_cy - pred_h * 0.5f;
-                        float x1 = pred_cx + pred_w * 0.5f;
-                        float y1 = pred_cy + pred_h * 0.5f;
-
-                        Object obj;
-                        obj.rect.x = x0;
-                        obj.rect.y = y0;
-                        obj.rect.width = x1 - x0;
-                        obj.rect.height = y1 - y0;
-                        obj.label = class_index;
-                        obj.prob = final_score;
-                        objects.push_back(obj);
-                    }
-
-                    feature_ptr += (cls_num + 5);
-                }
-            }
-        }
+        auto emit = [&](Object& obj, const float*, int, int, float, float) {
+            objects.push_back(obj);
+        };
+        if (cls_num == 10)
+            generate_proposals_anchor<10, 0, true, ANCHOR_LAYOUT_HWA>(stride, feat, prob_threshold, prob_threshold_unsigmoid,
+                                                                      letterbox_cols, letterbox_rows, anchors, cls_num, 0, emit);
+        else
+            generate_proposals_anchor<0, 0, true, ANCHOR_LAYOUT_HWA>(stride, feat, prob_threshold, prob_threshold_unsigmoid,
+                                                                     letterbox_cols, letterbox_rows, anchors, cls_num, 0, emit);
     }
 
     static void generate_proposals_yolov6(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
@@ -935,197 +1290,65 @@ namespace detection
     static void generate_proposals_yolov7_face(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
                                                int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid)
     {
-        int anchor_num = 3;
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int cls_num = 1;
-        int anchor_group;
-        if (stride == 8)
-            anchor_group = 1;
-        if (stride == 16)
-            anchor_group = 2;
-        if (stride == 32)
-            anchor_group = 3;
-
-        auto feature_ptr = feat;
-
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                for (int a = 0; a <= anchor_num - 1; a++)
+        /* [box, obj, 5 x (x, y, score), cls] */
+        generate_proposals_anchor<1, 15, false, ANCHOR_LAYOUT_HWA>(
+            stride, feat, prob_threshold, prob_threshold_unsigmoid, letterbox_cols, letterbox_rows, anchors, 1, 15,
+            [&](Object& obj, const float* ptr, int w, int h, float, float) {
+                const float* landmark_ptr = ptr + 6;
+                for (int l = 0; l < 5; l++)
                 {
-                    if (feature_ptr[4] < prob_threshold_unsigmoid)
-                    {
-                        feature_ptr += (cls_num + 5 + 15);
-                        continue;
-                    }
-
-                    //process cls score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    for (int s = 0; s <= cls_num - 1; s++)
-                    {
-                        float score = feature_ptr[s + 5 + 15];
-                        if (score > class_score)
-                        {
-                            class_index = s;
-                            class_score = score;
-                        }
-                    }
-                    //process box score
-                    float box_score = feature_ptr[4];
-                    float final_score = sigmoid(box_score) * sigmoid(class_score);
-
-                    if (final_score >= prob_threshold)
-                    {
-                        float dx = sigmoid(feature_ptr[0]);
-                        float dy = sigmoid(feature_ptr[1]);
-                        float dw = sigmoid(feature_ptr[2]);
-                        float dh = sigmoid(feature_ptr[3]);
-                        float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
-                        float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
-                        float anchor_w = anchors[(anchor_group - 1) * 6 + a * 2 + 0];
-                        float anchor_h = anchors[(anchor_group - 1) * 6 + a * 2 + 1];
-                        float pred_w = dw * dw * 4.0f * anchor_w;
-                        float pred_h = dh * dh * 4.0f * anchor_h;
-                        float x0 = pred_cx - pred_w * 0.5f;
-                        float y0 = pred_cy - pred_h * 0.5f;
-                        float x1 = pred_cx + pred_w * 0.5f;
-                        float y1 = pred_cy + pred_h * 0.5f;
-
-                        Object obj;
-                        obj.rect.x = x0;
-                        obj.rect.y = y0;
-                        obj.rect.width = x1 - x0;
-                        obj.rect.height = y1 - y0;
-                        obj.label = class_index;
-                        obj.prob = final_score;
-
-                        const float* landmark_ptr = feature_ptr + 6;
-                        for (int l = 0; l < 5; l++)
-                        {
-                            float lx = (landmark_ptr[3 * l] * 2.0f - 0.5f + w) * stride;
-                            float ly = (landmark_ptr[3 * l + 1] * 2.0f - 0.5f + h) * stride;
-                            //float score = sigmoid(landmark_ptr[3 * l + 2]);
-                            obj.landmark[l] = cv::Point2f(lx, ly);
-                        }
-
-                        objects.push_back(obj);
-                    }
-
-                    feature_ptr += (cls_num + 5 + 15);
+                    float lx = (landmark_ptr[3 * l] * 2.0f - 0.5f + w) * stride;
+                    float ly = (landmark_ptr[3 * l + 1] * 2.0f - 0.5f + h) * stride;
+                    //float score = sigmoid(landmark_ptr[3 * l + 2]);
+                    obj.landmark[l] = cv::Point2f(lx, ly);
                 }
-            }
-        }
+                objects.push_back(obj);
+            });
     }
 
     static void generate_proposals_yolov7_palm(int stride, const float* feat, float prob_threshold, std::vector<PalmObject>& objects,
                                                int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid)
     {
-        int anchor_num = 3;
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int cls_num = 1;
-        int anchor_group;
-        if (stride == 8)
-            anchor_group = 1;
-        if (stride == 16)
-            anchor_group = 2;
-        if (stride == 32)
-            anchor_group = 3;
-
         const int landmark_sort[7] = {0, 3, 4, 5, 6, 1, 2};
-        auto feature_ptr = feat;
 
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                for (int a = 0; a <= anchor_num - 1; a++)
+        /* [box, obj, 7 x (x, y, score), cls], the palm rect is rebuilt from the landmarks */
+        generate_proposals_anchor<1, 21, false, ANCHOR_LAYOUT_HWA>(
+            stride, feat, prob_threshold, prob_threshold_unsigmoid, letterbox_cols, letterbox_rows, anchors, 1, 21,
+            [&](Object& det, const float* ptr, int w, int h, float, float) {
+                PalmObject obj;
+                obj.prob = det.prob;
+
+                const float* landmark_ptr = ptr + 6;
+                cv::Point2f tmp[7];
+                float min_x = FLT_MAX, min_y = FLT_MAX, max_x = 0, max_y = 0;
+                for (int l = 0; l < 7; l++)
                 {
-                    if (feature_ptr[4] < prob_threshold_unsigmoid)
-                    {
-                        feature_ptr += (cls_num + 5 + 21);
-                        continue;
-                    }
-
-                    //process cls score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    for (int s = 0; s <= cls_num - 1; s++)
-                    {
-                        float score = feature_ptr[s + 5 + 21];
-                        if (score > class_score)
-                        {
-                            class_index = s;
-                            class_score = score;
-                        }
-                    }
-                    //process box score
-                    float box_score = feature_ptr[4];
-                    float final_score = sigmoid(box_score) * sigmoid(class_score);
-
-                    if (final_score >= prob_threshold)
-                    {
-                        float dx = sigmoid(feature_ptr[0]);
-                        float dy = sigmoid(feature_ptr[1]);
-                        float dw = sigmoid(feature_ptr[2]);
-                        float dh = sigmoid(feature_ptr[3]);
-                        float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
-                        float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
-                        float anchor_w = anchors[(anchor_group - 1) * 6 + a * 2 + 0];
-                        float anchor_h = anchors[(anchor_group - 1) * 6 + a * 2 + 1];
-                        float pred_w = dw * dw * 4.0f * anchor_w;
-                        float pred_h = dh * dh * 4.0f * anchor_h;
-                        float x0 = pred_cx - pred_w * 0.5f;
-                        float y0 = pred_cy - pred_h * 0.5f;
-                        float x1 = pred_cx + pred_w * 0.5f;
-                        float y1 = pred_cy + pred_h * 0.5f;
-
-                        PalmObject obj;
-                        obj.rect.x = x0 / (float)letterbox_cols;
-                        obj.rect.y = y0 / (float)letterbox_rows;
-                        obj.rect.width = (x1 - x0) / (float)letterbox_cols;
-                        obj.rect.height = (y1 - y0) / (float)letterbox_rows;
-                        obj.prob = final_score;
-
-                        const float* landmark_ptr = feature_ptr + 6;
-                        std::vector<cv::Point2f> tmp(7);
-                        float min_x = FLT_MAX, min_y = FLT_MAX, max_x = 0, max_y = 0;
-                        for (int l = 0; l < 7; l++)
-                        {
-                            float lx = (landmark_ptr[3 * l] * 2.0f - 0.5f + w) * stride;
-                            float ly = (landmark_ptr[3 * l + 1] * 2.0f - 0.5f + h) * stride;
-                            lx /= (float)letterbox_cols;
-                            ly /= (float)letterbox_rows;
-
-                            tmp[l] = cv::Point2f(lx, ly);
-                            min_x = lx < min_x ? lx : min_x;
-                            min_y = ly < min_y ? ly : min_y;
-                            max_x = lx > max_x ? lx : max_x;
-                            max_y = ly > max_y ? ly : max_y;
-                        }
-                        float w = max_x - min_x;
-                        float h = max_y - min_y;
-                        float long_side = h > w ? h : w;
-                        long_side *= 1.1f;
-                        obj.rect.x = min_x + w * 0.5f - long_side * 0.5f;
-                        obj.rect.y = min_y + h * 0.5f - long_side * 0.5f;
-                        obj.rect.width = long_side;
-                        obj.rect.height = long_side;
-                        for (int l = 0; l < 7; l++)
-                        {
-                            obj.landmarks[l] = tmp[landmark_sort[l]];
-                        }
-
-                        objects.push_back(obj);
-                    }
-
-                    feature_ptr += (cls_num + 5 + 21);
+                    float lx = (landmark_ptr[3 * l] * 2.0f - 0.5f + w) * stride;
+                    float ly = (landmark_ptr[3 * l + 1] * 2.0f - 0.5f + h) * stride;
+                    lx /= (float)letterbox_cols;
+                    ly /= (float)letterbox_rows;
+
+                    tmp[l] = cv::Point2f(lx, ly);
+                    min_x = lx < min_x ? lx : min_x;
+                    min_y = ly < min_y ? ly : min_y;
+                    max_x = lx > max_x ? lx : max_x;
+                    max_y = ly > max_y ? ly : max_y;
                 }
-            }
-        }
+                float bw = max_x - min_x;
+                float bh = max_y - min_y;
+                float long_side = bh > bw ? bh : bw;
+                long_side *= 1.1f;
+                obj.rect.x = min_x + bw * 0.5f - long_side * 0.5f;
+                obj.rect.y = min_y + bh * 0.5f - long_side * 0.5f;
+                obj.rect.width = long_side;
+                obj.rect.height = long_side;
+                for (int l = 0; l < 7; l++)
+                {
+                    obj.landmarks[l] = tmp[landmark_sort[l]];
+                }
+
+                objects.push_back(obj);
+            });
     }
 
     static void generate_proposals_yolov8(int stride, const float* dfl_feat, const float* cls_feat, const float* cls_idx, float prob_threshold, std::vector<Object>& objects,
@@ -1134,12 +1357,12 @@ namespace detection
         int feat_w = letterbox_cols / stride;
         int feat_h = letterbox_rows / stride;
         int reg_max = 16;
+        const float prob_threshold_unsigmoid = unsigmoid(prob_threshold);
 
         auto dfl_ptr = dfl_feat;
         auto cls_ptr = cls_feat;
         auto cls_idx_ptr = cls_idx;
 
-        std::vector<float> dis_after_sm(reg_max, 0.f);
         for (int h = 0; h <= feat_h - 1; h++)
         {
             for (int w = 0; w <= feat_w - 1; w++)
@@ -1148,16 +1371,12 @@ namespace detection
                 int class_index = static_cast<int>(cls_idx_ptr[h * feat_w + w]);
                 float class_score = cls_ptr[h * feat_w * cls_num + w * cls_num + class_index];
 
-                float box_prob = sigmoid(class_score);
+                float box_prob = class_score < prob_threshold_unsigmoid ? 0.f : sigmoid(class_score);
 
                 if (box_prob > prob_threshold)
                 {
                     float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(dfl_ptr + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * stride;
-                    }
+                    simd::dfl_decode(dfl_ptr, reg_max, stride, pred_ltrb);
 
                     float pb_cx = (w + 0.5f) * stride;
                     float pb_cy = (h + 0.5f) * stride;
@@ -1193,12 +1412,12 @@ namespace detection
         int feat_w = letterbox_cols / stride;
         int feat_h = letterbox_rows / stride;
         int reg_max = 16;
+        const float prob_threshold_unsigmoid = unsigmoid(prob_threshold);
 
         auto dfl_ptr = dfl_feat;
         auto cls_ptr = cls_feat;
         auto cls_idx_ptr = cls_idx;
 
-        std::vector<float> dis_after_sm(reg_max, 0.f);
         for (int h = 0; h <= feat_h - 1; h++)
         {
             for (int w = 0; w <= feat_w - 1; w++)
@@ -1207,15 +1426,11 @@ namespace detection
                 int class_index = static_cast<int>(cls_idx_ptr[h * feat_w + w]);
                 float class_score = cls_ptr[h * feat_w * cls_num + w * cls_num + class_index];
 
-                float box_prob = sigmoid(class_score);
+                float box_prob = class_score < prob_threshold_unsigmoid ? 0.f : sigmoid(class_score);
                 if (box_prob > prob_threshold)
                 {
                     float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(dfl_ptr + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * stride;
-                    }
+                    simd::dfl_decode(dfl_ptr, reg_max, stride, pred_ltrb);
 
                     float pb_cx = (w + 0.5f) * stride;
                     float pb_cy = (h + 0.5f) * stride;
@@ -1256,8 +1471,8 @@ namespace detection
         int feat_w = letterbox_cols / stride;
         int feat_h = letterbox_rows / stride;
         int reg_max = 16;
+        const float prob_threshold_unsigmoid = unsigmoid(prob_threshold);
 
-        std::vector<float> dis_after_sm(reg_max, 0.f);
         for (int h = 0; h <= feat_h - 1; h++)
         {
             for (int w = 0; w <= feat_w - 1; w++)
@@ -1267,15 +1482,11 @@ namespace detection
                 auto bboxes = feat + 1;
                 auto kps = feat + 1 + 4 * reg_max;
 
-                float box_prob = sigmoid(*scores);
+                float box_prob = *scores < prob_threshold_unsigmoid ? 0.f : sigmoid(*scores);
                 if (box_prob > prob_threshold)
                 {
                     float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(bboxes + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * stride;
-                    }
+                    simd::dfl_decode(bboxes, reg_max, stride, pred_ltrb);
 
                     float pb_cx = (w + 0.5f) * stride;
                     float pb_cy = (h + 0.5f) * stride;
@@ -1320,36 +1531,23 @@ namespace detection
         int feat_w = letterbox_cols / stride;
         int feat_h = letterbox_rows / stride;
         int reg_max = 16;
+        const float prob_threshold_unsigmoid = unsigmoid(prob_threshold);
 
         auto feat_ptr = feat;
 
-        std::vector<float> dis_after_sm(reg_max, 0.f);
         for (int h = 0; h <= feat_h - 1; h++)
         {
             for (int w = 0; w <= feat_w - 1; w++)
             {
                 // process cls score
-                int class_index = 0;
-                float class_score = -FLT_MAX;
-                for (int s = 0; s < cls_num; s++)
-                {
-                    float score = feat_ptr[s + 4 * reg_max];
-                    if (score > class_score)
-                    {
-                        class_index = s;
-                        class_score = score;
-                    }
-                }
+                float class_score;
+                int class_index = simd::argmax(feat_ptr + 4 * reg_max, cls_num, &class_score);
 
-                float box_prob = sigmoid(class_score);
+                float box_prob = class_score < prob_threshold_unsigmoid ? 0.f : sigmoid(class_score);
                 if (box_prob > prob_threshold)
                 {
                     float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(feat_ptr + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * stride;
-                    }
+                    simd::dfl_decode(feat_ptr, reg_max, stride, pred_ltrb);
 
                     float pb_cx = (w + 0.5f) * stride;
                     float pb_cy = (h + 0.5f) * stride;
@@ -1380,181 +1578,39 @@ namespace detection
         }
     }
     
-    static void generate_proposals_yolov8_native(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
-                                                 int letterbox_cols, int letterbox_rows, int cls_num = 80)
-    {
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int reg_max = 16;
-
-        auto feat_ptr = feat;
-
-        std::vector<float> dis_after_sm(reg_max, 0.f);
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                // process cls score
-                int class_index = 0;
-                float class_score = -FLT_MAX;
-                for (int s = 0; s < cls_num; s++)
-                {
-                    float score = feat_ptr[s + 4 * reg_max];
-                    if (score > class_score)
-                    {
-                        class_index = s;
-                        class_score = score;
-                    }
-                }
-
-                float box_prob = sigmoid(class_score);
-                if (box_prob > prob_threshold)
-                {
-                    float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(feat_ptr + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * stride;
-                    }
-
-                    float pb_cx = (w + 0.5f) * stride;
-                    float pb_cy = (h + 0.5f) * stride;
-
-                    float x0 = pb_cx - pred_ltrb[0];
-                    float y0 = pb_cy - pred_ltrb[1];
-                    float x1 = pb_cx + pred_ltrb[2];
-                    float y1 = pb_cy + pred_ltrb[3];
-
-                    x0 = std::max(std::min(x0, (float)(letterbox_cols - 1)), 0.f);
-                    y0 = std::max(std::min(y0, (float)(letterbox_rows - 1)), 0.f);
-                    x1 = std::max(std::min(x1, (float)(letterbox_cols - 1)), 0.f);
-                    y1 = std::max(std::min(y1, (float)(letterbox_rows - 1)), 0.f);
-
-                    Object obj;
-                    obj.rect.x = x0;
-                    obj.rect.y = y0;
-                    obj.rect.width = x1 - x0;
-                    obj.rect.height = y1 - y0;
-                    obj.label = class_index;
-                    obj.prob = box_prob;
-
-                    objects.push_back(obj);
-                }
-
-                feat_ptr += (cls_num + 4 * reg_max);
-            }
-        }
-    }
-
-    static void generate_proposals_yolov8_seg_native(int stride, const float* feat, const float* feat_seg, float prob_threshold, std::vector<Object>& objects,
-                                                     int letterbox_cols, int letterbox_rows, int cls_num = 80, int mask_proto_dim = 32)
+    /*
+     * Shared loop of the anchor free DFL heads in the native layout (4 * 16 box
+     * logits followed by cls_num class logits per cell). feat is float or a
+     * quantized tensor described by qp; the class threshold is compared on the
+     * stored values and only the surviving cells are dequantized.
+     * emit(x0, y0, x1, y1, prob, label, h, w) receives every cell above the
+     * threshold, with the box already clipped to the letterbox.
+     */
+    template<typename T, typename Emit>
+    static void generate_proposals_dfl_native(int stride, const T* feat, const quant::QuantParam& qp, float prob_threshold, int letterbox_cols, int letterbox_rows, int cls_num,
+                                              int row_begin, int row_end, Emit emit)
     {
         int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
+        int feat_h = std::min(letterbox_rows / stride, row_end);
         int reg_max = 16;
+        const auto class_threshold = quant::threshold(unsigmoid(prob_threshold), qp, feat);
+        float dfl_buf[4 * 16];
 
-        auto feat_ptr = feat;
-        auto feat_seg_ptr = feat_seg;
+        auto feat_ptr = feat + (size_t)row_begin * feat_w * (cls_num + 4 * reg_max);
 
-        std::vector<float> dis_after_sm(reg_max, 0.f);
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                // process cls score
-                int class_index = 0;
-                float class_score = -FLT_MAX;
-                for (int s = 0; s < cls_num; s++)
-                {
-                    float score = feat_ptr[s + 4 * reg_max];
-                    if (score > class_score)
-                    {
-                        class_index = s;
-                        class_score = score;
-                    }
-                }
-
-                float box_prob = sigmoid(class_score);
-                if (box_prob > prob_threshold)
-                {
-                    float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(feat_ptr + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * stride;
-                    }
-
-                    float pb_cx = (w + 0.5f) * stride;
-                    float pb_cy = (h + 0.5f) * stride;
-
-                    float x0 = pb_cx - pred_ltrb[0];
-                    float y0 = pb_cy - pred_ltrb[1];
-                    float x1 = pb_cx + pred_ltrb[2];
-                    float y1 = pb_cy + pred_ltrb[3];
-
-                    x0 = std::max(std::min(x0, (float)(letterbox_cols - 1)), 0.f);
-                    y0 = std::max(std::min(y0, (float)(letterbox_rows - 1)), 0.f);
-                    x1 = std::max(std::min(x1, (float)(letterbox_cols - 1)), 0.f);
-                    y1 = std::max(std::min(y1, (float)(letterbox_rows - 1)), 0.f);
-
-                    Object obj;
-                    obj.rect.x = x0;
-                    obj.rect.y = y0;
-                    obj.rect.width = x1 - x0;
-                    obj.rect.height = y1 - y0;
-                    obj.label = class_index;
-                    obj.prob = box_prob;
-                    obj.mask_feat.resize(mask_proto_dim);
-                    memcpy(obj.mask_feat.data(), feat_seg_ptr, sizeof(float) * mask_proto_dim);
-                    // for (int k = 0; k < mask_proto_dim; k++)
-                    // {
-                    //     obj.mask_feat[k] = feat_seg_ptr[k];
-                    // }
-                    objects.push_back(obj);
-                }
-
-                feat_ptr += cls_num + 4 * reg_max;
-                feat_seg_ptr += mask_proto_dim;
-            }
-        }
-    }
-
-    static void generate_proposals_yolov8_pose_native(int stride, const float* feat, const float* feat_kps, float prob_threshold, std::vector<Object>& objects,
-                                                      int letterbox_cols, int letterbox_rows, const int num_point = 17, int cls_num = 1)
-    {
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int reg_max = 16;
-
-        auto feat_ptr = feat;
-
-        std::vector<float> dis_after_sm(reg_max, 0.f);
-        for (int h = 0; h <= feat_h - 1; h++)
+        for (int h = row_begin; h <= feat_h - 1; h++)
         {
             for (int w = 0; w <= feat_w - 1; w++)
             {
                 // process cls score
-                int class_index = 0;
-                float class_score = -FLT_MAX;
-                for (int s = 0; s < cls_num; s++)
-                {
-                    float score = feat_ptr[s + 4 * reg_max];
-                    if (score > class_score)
-                    {
-                        class_index = s;
-                        class_score = score;
-                    }
-                }
+                typename std::remove_const<decltype(class_threshold)>::type class_score;
+                int class_index = quant::argmax(feat_ptr + 4 * reg_max, cls_num, &class_score);
 
-                float box_prob = sigmoid(class_score);
+                float box_prob = class_score < class_threshold ? 0.f : sigmoid(quant::dequantize(class_score, qp));
                 if (box_prob > prob_threshold)
                 {
                     float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(feat_ptr + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * stride;
-                    }
+                    simd::dfl_decode(quant::dequantize(feat_ptr, 4 * reg_max, qp, dfl_buf), reg_max, stride, pred_ltrb);
 
                     float pb_cx = (w + 0.5f) * stride;
                     float pb_cy = (h + 0.5f) * stride;
@@ -1569,29 +1625,302 @@ namespace detection
                     x1 = std::max(std::min(x1, (float)(letterbox_cols - 1)), 0.f);
                     y1 = std::max(std::min(y1, (float)(letterbox_rows - 1)), 0.f);
 
-                    Object obj;
-                    obj.rect.x = x0;
-                    obj.rect.y = y0;
-                    obj.rect.width = x1 - x0;
-                    obj.rect.height = y1 - y0;
-                    obj.label = class_index;
-                    obj.prob = box_prob;
-                    obj.kps_feat.clear();
-                    for (int k = 0; k < num_point; k++)
-                    {
-                        float kps_x = (feat_kps[k * 3] * 2.f + w) * stride;
-                        float kps_y = (feat_kps[k * 3 + 1] * 2.f + h) * stride;
-                        float kps_s = sigmoid(feat_kps[k * 3 + 2]);
-                        obj.kps_feat.push_back(kps_x);
-                        obj.kps_feat.push_back(kps_y);
-                        obj.kps_feat.push_back(kps_s);
-                    }
-                    objects.push_back(obj);
+                    emit(x0, y0, x1, y1, box_prob, class_index, h, w);
                 }
-                feat_ptr += (cls_num + 4 * reg_max);
-                feat_kps += 3 * num_point;
+
+                feat_ptr += cls_num + 4 * reg_max;
+            }
+        }
+    }
+
+    /* all rows of the head */
+    template<typename T, typename Emit>
+    static void generate_proposals_dfl_native(int stride, const T* feat, const quant::QuantParam& qp, float prob_threshold, int letterbox_cols, int letterbox_rows, int cls_num, Emit emit)
+    {
+        generate_proposals_dfl_native(stride, feat, qp, prob_threshold, letterbox_cols, letterbox_rows, cls_num, 0, INT_MAX, emit);
+    }
+
+    static inline void fill_object(Object& obj, float x0, float y0, float x1, float y1, float prob, int label)
+    {
+        obj.rect.x = x0;
+        obj.rect.y = y0;
+        obj.rect.width = x1 - x0;
+        obj.rect.height = y1 - y0;
+        obj.label = label;
+        obj.prob = prob;
+    }
+
+    /* (x, y, score) per keypoint of cell (h, w) */
+    template<typename T>
+    static inline void decode_kps_native(const T* feat_kps, int num_point, int h, int w, int stride, float* kps, const quant::QuantParam& qp = quant::QUANT_NONE)
+    {
+        for (int k = 0; k < num_point; k++)
+        {
+            kps[k * 3] = (quant::dequantize(feat_kps[k * 3], qp) * 2.f + w) * stride;
+            kps[k * 3 + 1] = (quant::dequantize(feat_kps[k * 3 + 1], qp) * 2.f + h) * stride;
+            kps[k * 3 + 2] = sigmoid(quant::dequantize(feat_kps[k * 3 + 2], qp));
+        }
+    }
+
+    /*
+     * With lb given the detection and pose decoders emit source image
+     * coordinates, so the get_out_*_mapped forms only run NMS and clip the
+     * survivors. Seg heads stay in letterbox space since the mask crop needs
+     * letterbox boxes. row_begin / row_end restrict decoding to a band of
+     * feature rows, see DecodeScheduler.
+     */
+    static void generate_proposals_yolov8_native(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
+                                                 int letterbox_cols, int letterbox_rows, int cls_num = 80, const LetterboxTransform* lb = nullptr,
+                                                 int row_begin = 0, int row_end = INT_MAX)
+    {
+        generate_proposals_dfl_native(stride, feat, quant::QUANT_NONE, prob_threshold, letterbox_cols, letterbox_rows, cls_num, row_begin, row_end,
+                                      [&](float x0, float y0, float x1, float y1, float prob, int label, int, int) {
+                                          if (lb)
+                                              lb->map_corners(x0, y0, x1, y1);
+                                          Object obj;
+                                          fill_object(obj, x0, y0, x1, y1, prob, label);
+                                          objects.push_back(obj);
+                                      });
+    }
+
+    static void generate_proposals_yolov8_seg_native(int stride, const float* feat, const float* feat_seg, float prob_threshold, std::vector<Object>& objects,
+                                                     int letterbox_cols, int letterbox_rows, int cls_num = 80, int mask_proto_dim = 32)
+    {
+        int feat_w = letterbox_cols / stride;
+        generate_proposals_dfl_native(stride, feat, quant::QUANT_NONE, prob_threshold, letterbox_cols, letterbox_rows, cls_num,
+                                      [&](float x0, float y0, float x1, float y1, float prob, int label, int h, int w) {
+                                          Object obj;
+                                          fill_object(obj, x0, y0, x1, y1, prob, label);
+                                          const float* feat_seg_ptr = feat_seg + (size_t)(h * feat_w + w) * mask_proto_dim;
+                                          obj.mask_feat.assign(feat_seg_ptr, feat_seg_ptr + mask_proto_dim);
+                                          objects.push_back(obj);
+                                      });
+    }
+
+    /* proposals must be reset with mask_dim == mask_proto_dim */
+    static void generate_proposals_yolov8_seg_native(int stride, const float* feat, const float* feat_seg, float prob_threshold, ProposalBuffer& proposals,
+                                                     int letterbox_cols, int letterbox_rows, int cls_num = 80, int mask_proto_dim = 32)
+    {
+        int feat_w = letterbox_cols / stride;
+        generate_proposals_dfl_native(stride, feat, quant::QUANT_NONE, prob_threshold, letterbox_cols, letterbox_rows, cls_num,
+                                      [&](float x0, float y0, float x1, float y1, float prob, int label, int h, int w) {
+                                          int index = proposals.push(x0, y0, x1, y1, prob, label);
+                                          const float* feat_seg_ptr = feat_seg + (size_t)(h * feat_w + w) * mask_proto_dim;
+                                          memcpy(proposals.mask_feat_of(index), feat_seg_ptr, sizeof(float) * mask_proto_dim);
+                                      });
+    }
+
+    static void generate_proposals_yolov8_pose_native(int stride, const float* feat, const float* feat_kps, float prob_threshold, std::vector<Object>& objects,
+                                                      int letterbox_cols, int letterbox_rows, const int num_point = 17, int cls_num = 1, const LetterboxTransform* lb = nullptr)
+    {
+        int feat_w = letterbox_cols / stride;
+        generate_proposals_dfl_native(stride, feat, quant::QUANT_NONE, prob_threshold, letterbox_cols, letterbox_rows, cls_num,
+                                      [&](float x0, float y0, float x1, float y1, float prob, int label, int h, int w) {
+                                          if (lb)
+                                              lb->map_corners(x0, y0, x1, y1);
+                                          Object obj;
+                                          fill_object(obj, x0, y0, x1, y1, prob, label);
+                                          obj.kps_feat.resize(3 * num_point);
+                                          decode_kps_native(feat_kps + (size_t)(h * feat_w + w) * 3 * num_point, num_point, h, w, stride, obj.kps_feat.data());
+                                          if (lb)
+                                              lb->map_kps(obj.kps_feat.data(), num_point);
+                                          objects.push_back(obj);
+                                      });
+    }
+
+    /* proposals must be reset with kps_dim == 3 * num_point */
+    static void generate_proposals_yolov8_pose_native(int stride, const float* feat, const float* feat_kps, float prob_threshold, ProposalBuffer& proposals,
+                                                      int letterbox_cols, int letterbox_rows, const int num_point = 17, int cls_num = 1, const LetterboxTransform* lb = nullptr)
+    {
+        int feat_w = letterbox_cols / stride;
+        generate_proposals_dfl_native(stride, feat, quant::QUANT_NONE, prob_threshold, letterbox_cols, letterbox_rows, cls_num,
+                                      [&](float x0, float y0, float x1, float y1, float prob, int label, int h, int w) {
+                                          if (lb)
+                                              lb->map_corners(x0, y0, x1, y1);
+                                          int index = proposals.push(x0, y0, x1, y1, prob, label);
+                                          decode_kps_native(feat_kps + (size_t)(h * feat_w + w) * 3 * num_point, num_point, h, w, stride, proposals.kps_feat_of(index));
+                                          if (lb)
+                                              lb->map_kps(proposals.kps_feat_of(index), num_point);
+                                      });
+    }
+
+    /*
+     * Variants for heads left quantized by the toolchain (int8_t, uint8_t,
+     * int16_t, ...). Each tensor comes with its own scale / zero point from the
+     * model conversion, T may also be float with quant::QUANT_NONE.
+     */
+    template<typename T>
+    static void generate_proposals_yolov8_native(int stride, const T* feat, const quant::QuantParam& qp, float prob_threshold, std::vector<Object>& objects,
+                                                 int letterbox_cols, int letterbox_rows, int cls_num = 80, const LetterboxTransform* lb = nullptr,
+                                                 int row_begin = 0, int row_end = INT_MAX)
+    {
+        generate_proposals_dfl_native(stride, feat, qp, prob_threshold, letterbox_cols, letterbox_rows, cls_num, row_begin, row_end,
+                                      [&](float x0, float y0, float x1, float y1, float prob, int label, int, int) {
+                                          if (lb)
+                                              lb->map_corners(x0, y0, x1, y1);
+                                          Object obj;
+                                          fill_object(obj, x0, y0, x1, y1, prob, label);
+                                          objects.push_back(obj);
+                                      });
+    }
+
+    template<typename T, typename S>
+    static void generate_proposals_yolov8_seg_native(int stride, const T* feat, const quant::QuantParam& qp, const S* feat_seg, const quant::QuantParam& seg_qp, float prob_threshold,
+                                                     ProposalBuffer& proposals, int letterbox_cols, int letterbox_rows, int cls_num = 80, int mask_proto_dim = 32)
+    {
+        int feat_w = letterbox_cols / stride;
+        generate_proposals_dfl_native(stride, feat, qp, prob_threshold, letterbox_cols, letterbox_rows, cls_num,
+                                      [&](float x0, float y0, float x1, float y1, float prob, int label, int h, int w) {
+                                          int index = proposals.push(x0, y0, x1, y1, prob, label);
+                                          const S* feat_seg_ptr = feat_seg + (size_t)(h * feat_w + w) * mask_proto_dim;
+                                          float* mask_feat = proposals.mask_feat_of(index);
+                                          for (int k = 0; k < mask_proto_dim; k++)
+                                          {
+                                              mask_feat[k] = quant::dequantize(feat_seg_ptr[k], seg_qp);
+                                          }
+                                      });
+    }
+
+    template<typename T, typename K>
+    static void generate_proposals_yolov8_pose_native(int stride, const T* feat, const quant::QuantParam& qp, const K* feat_kps, const quant::QuantParam& kps_qp, float prob_threshold,
+                                                      ProposalBuffer& proposals, int letterbox_cols, int letterbox_rows, const int num_point = 17, int cls_num = 1, const LetterboxTransform* lb = nullptr)
+    {
+        int feat_w = letterbox_cols / stride;
+        generate_proposals_dfl_native(stride, feat, qp, prob_threshold, letterbox_cols, letterbox_rows, cls_num,
+                                      [&](float x0, float y0, float x1, float y1, float prob, int label, int h, int w) {
+                                          if (lb)
+                                              lb->map_corners(x0, y0, x1, y1);
+                                          int index = proposals.push(x0, y0, x1, y1, prob, label);
+                                          decode_kps_native(feat_kps + (size_t)(h * feat_w + w) * 3 * num_point, num_point, h, w, stride, proposals.kps_feat_of(index), kps_qp);
+                                          if (lb)
+                                              lb->map_kps(proposals.kps_feat_of(index), num_point);
+                                      });
+    }
+
+    /*
+     * Splits the decode of several output heads into tasks (a whole head, or a
+     * band of rows of a large one) and runs them on a persistent thread pool.
+     * Every task appends to its own buffer and merge() concatenates them in
+     * task order, which is the order of the sequential per-head loop, so the
+     * proposals (and everything after NMS) don't depend on the thread count.
+     * Buffers keep their capacity between frames.
+     */
+    template<typename T = Object>
+    class DecodeScheduler
+    {
+    public:
+        typedef struct Task
+        {
+            int head;
+            int row_begin;
+            int row_end;
+        } Task;
+
+        /* pool may be null, tasks then run on the calling thread */
+        explicit DecodeScheduler(utilities::thread_pool* pool = nullptr)
+            : m_pool(pool)
+        {
+        }
+
+        /*
+         * One task per band of at most max_tile_cells cells (at least one row),
+         * head_rows[i] x head_cols[i] is the feature map size of head i.
+         */
+        void plan(const int* head_rows, const int* head_cols, int head_count, int max_tile_cells = 1600)
+        {
+            m_tasks.clear();
+            for (int i = 0; i < head_count; i++)
+            {
+                int tile_rows = std::max(1, max_tile_cells / std::max(head_cols[i], 1));
+                for (int r = 0; r < head_rows[i]; r += tile_rows)
+                {
+                    m_tasks.push_back(Task{i, r, std::min(r + tile_rows, head_rows[i])});
+                }
+            }
+            if (m_buffers.size() < m_tasks.size())
+                m_buffers.resize(m_tasks.size());
+        }
+
+        /* func(const Task&, std::vector<T>& out) decodes one task into out */
+        template<typename Func>
+        void run(Func func)
+        {
+            const int count = (int)m_tasks.size();
+            auto job = [&](int t) {
+                m_buffers[t].clear();
+                func(m_tasks[t], m_buffers[t]);
+            };
+            if (m_pool)
+                m_pool->parallel_for(count, job);
+            else
+                for (int t = 0; t < count; t++)
+                    job(t);
+        }
+
+        /* appends the task buffers to proposals in task order */
+        void merge(std::vector<T>& proposals) const
+        {
+            size_t total = proposals.size();
+            for (size_t t = 0; t < m_tasks.size(); t++)
+            {
+                total += m_buffers[t].size();
             }
+            proposals.reserve(total);
+            for (size_t t = 0; t < m_tasks.size(); t++)
+            {
+                proposals.insert(proposals.end(), m_buffers[t].begin(), m_buffers[t].end());
+            }
+        }
+
+        const std::vector<Task>& tasks() const
+        {
+            return m_tasks;
+        }
+
+    private:
+        utilities::thread_pool* m_pool;
+        std::vector<Task> m_tasks;
+        std::vector<std::vector<T> > m_buffers;
+    };
+
+    /* yolov8 / yolo11 native heads (strides 8, 16, 32, ...) through a DecodeScheduler */
+    static void generate_proposals_yolov8_native(DecodeScheduler<Object>& scheduler, const float* const* feats, int head_count, float prob_threshold, std::vector<Object>& objects,
+                                                 int letterbox_cols, int letterbox_rows, int cls_num = 80, const LetterboxTransform* lb = nullptr)
+    {
+        int head_rows[8], head_cols[8];
+        head_count = std::min(head_count, 8);
+        for (int i = 0; i < head_count; i++)
+        {
+            head_rows[i] = letterbox_rows / (8 << i);
+            head_cols[i] = letterbox_cols / (8 << i);
+        }
+        scheduler.plan(head_rows, head_cols, head_count);
+        scheduler.run([&](const DecodeScheduler<Object>::Task& task, std::vector<Object>& out) {
+            generate_proposals_yolov8_native(8 << task.head, feats[task.head], prob_threshold, out, letterbox_cols, letterbox_rows, cls_num, lb, task.row_begin, task.row_end);
+        });
+        scheduler.merge(objects);
+    }
+
+    /*
+     * yolov5 anchor heads through a DecodeScheduler. The anchor decoder has no
+     * row bands, so every head is a single task.
+     */
+    static void generate_proposals_yolov5(DecodeScheduler<Object>& scheduler, const float* const* feats, int head_count, float prob_threshold, std::vector<Object>& objects,
+                                          int letterbox_cols, int letterbox_rows, const float* anchors, float prob_threshold_unsigmoid, int cls_num = 80,
+                                          const LetterboxTransform* lb = nullptr)
+    {
+        int head_rows[8], head_cols[8];
+        head_count = std::min(head_count, 8);
+        for (int i = 0; i < head_count; i++)
+        {
+            head_rows[i] = letterbox_rows / (8 << i);
+            head_cols[i] = letterbox_cols / (8 << i);
         }
+        scheduler.plan(head_rows, head_cols, head_count, INT_MAX);
+        scheduler.run([&](const DecodeScheduler<Object>::Task& task, std::vector<Object>& out) {
+            generate_proposals_yolov5(8 << task.head, feats[task.head], prob_threshold, out, letterbox_cols, letterbox_rows, anchors, prob_threshold_unsigmoid, cls_num, lb);
+        });
+        scheduler.merge(objects);
     }
 
         static void generate_proposals_yolo_world(int stride, const float* feat_cls, const float* feat_reg, float exp, float bias, float prob_threshold, std::vector<Object>& objects,
@@ -1600,39 +1929,26 @@ namespace detection
         int feat_w = letterbox_cols / stride;
         int feat_h = letterbox_rows / stride;
         int reg_max = 16;
+        const float prob_threshold_unsigmoid = unsigmoid(prob_threshold);
 
         auto feat_cls_ptr = feat_cls;
         auto feat_reg_ptr = feat_reg;
 
-        std::vector<float> dis_after_sm(reg_max, 0.f);
         for (int h = 0; h <= feat_h - 1; h++)
         {
             for (int w = 0; w <= feat_w - 1; w++)
             {
                 // process cls score
-                int class_index = 0;
-                float class_score = -FLT_MAX;
-                for (int s = 0; s < cls_num; s++)
-                {
-                    float score = feat_cls_ptr[s];
-                    if (score > class_score)
-                    {
-                        class_index = s;
-                        class_score = score;
-                    }
-                }
+                float class_score;
+                int class_index = simd::argmax(feat_cls_ptr, cls_num, &class_score);
 
                 class_score = class_score * exp + bias;
 
-                float box_prob = sigmoid(class_score);
+                float box_prob = class_score < prob_threshold_unsigmoid ? 0.f : sigmoid(class_score);
                 if (box_prob > prob_threshold)
                 {
                     float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(feat_reg_ptr + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * stride;
-                    }
+                    simd::dfl_decode(feat_reg_ptr, reg_max, stride, pred_ltrb);
 
                     float pb_cx = (w + 0.5f) * stride;
                     float pb_cy = (h + 0.5f) * stride;
@@ -1667,74 +1983,16 @@ namespace detection
     static void generate_proposals(int stride, const float* feat, float prob_threshold, std::vector<Object>& objects,
                                    int letterbox_cols, int letterbox_rows, const float* anchors, int cls_num = 80)
     {
-        int anchor_num = 3;
-        int feat_w = letterbox_cols / stride;
-        int feat_h = letterbox_rows / stride;
-        int anchor_group;
-        if (stride == 8)
-            anchor_group = 1;
-        if (stride == 16)
-            anchor_group = 2;
-        if (stride == 32)
-            anchor_group = 3;
-
-        int w_stride = (cls_num + 5);
-        int h_stride = feat_w * w_stride;
-        int a_stride = feat_h * h_stride;
-
-        for (int h = 0; h <= feat_h - 1; h++)
-        {
-            for (int w = 0; w <= feat_w - 1; w++)
-            {
-                for (int a = 0; a <= anchor_num - 1; a++)
-                {
-                    //process cls score
-                    int class_index = 0;
-                    float class_score = -FLT_MAX;
-                    int offset = a * a_stride + h * h_stride + w * w_stride;
-                    for (int s = 0; s <= cls_num - 1; s++)
-                    {
-                        float score = feat[offset + s + 5];
-                        if (score > class_score)
-                        {
-                            class_index = s;
-                            class_score = score;
-                        }
-                    }
-                    //process box score
-                    float box_score = feat[offset + 4];
-                    float final_score = sigmoid(box_score) * sigmoid(class_score);
-
-                    if (final_score >= prob_threshold)
-                    {
-                        int loc_idx = offset;
-                        float dx = sigmoid(feat[loc_idx + 0]);
-                        float dy = sigmoid(feat[loc_idx + 1]);
-                        float dw = sigmoid(feat[loc_idx + 2]);
-                        float dh = sigmoid(feat[loc_idx + 3]);
-                        float pred_cx = (dx * 2.0f - 0.5f + w) * stride;
-                        float pred_cy = (dy * 2.0f - 0.5f + h) * stride;
-                        float anchor_w = anchors[(anchor_group - 1) * 6 + a * 2 + 0];
-                        float anchor_h = anchors[(anchor_group - 1) * 6 + a * 2 + 1];
-                        float pred_w = dw * dw * 4.0f * anchor_w;
-                        float pred_h = dh * dh * 4.0f * anchor_h;
-                        float x0 = pred_cx - pred_w * 0.5f;
-                        float y0 = pred_cy - pred_h * 0.5f;
-                        float x1 = pred_cx + pred_w * 0.5f;
-                        float y1 = pred_cy + pred_h * 0.5f;
-
-                        Object obj;
-                        obj.rect.x = x0;
-                        obj.rect.y = y0;
-                        obj.rect.width = x1 - x0;
-                        obj.rect.height = y1 - y0;
-                        obj.label = class_index;
-                        obj.prob = final_score;
-                        objects.push_back(obj);
-                    }
-                }
-            }
-        }
+        /* anchor-major output, no objectness pre-filter */
+        auto emit = [&](Object& obj, const float*, int, int, float, float) {
+            objects.push_back(obj);
+        };
+        if (cls_num == 80)
+            generate_proposals_anchor<80, 0, true, ANCHOR_LAYOUT_AHW>(stride, feat, prob_threshold, -FLT_MAX,
+                                                                      letterbox_cols, letterbox_rows, anchors, cls_num, 0, emit);
+        else
+            generate_proposals_anchor<0, 0, true, ANCHOR_LAYOUT_AHW>(stride, feat, prob_threshold, -FLT_MAX,
+                                                                     letterbox_cols, letterbox_rows, anchors, cls_num, 0, emit);
     }
 
     static void generate_proposals_palm(std::vector<PalmObject>& region_list, float score_thresh, int input_img_w, int input_img_h, float* scores_ptr, float* bboxes_ptr, int head_count, const int* strides, const int* anchor_size, const float* anchor_offset, const int* feature_map_size, float prob_threshold_unsigmoid)
@@ -1910,7 +2168,8 @@ namespace detection
         cv::imwrite(std::string(output_name) + ".jpg", image);
     }
 
-    static void draw_objects_mask(const cv::Mat& bgr, const std::vector<Object>& objects, const char** class_names, const std::vector<std::vector<uint8_t> >& colors, const char* output_name)
+    static void draw_objects_mask(const cv::Mat& bgr, const std::vector<Object>& objects, const char** class_names, const std::vector<std::vector<uint8_t> >& colors, const char* output_name,
+                                  const std::vector<mask::BitMask>* bitmasks = nullptr)
     {
         cv::Mat image = bgr.clone();
         cv::Mat mask = bgr.clone();
@@ -1925,7 +2184,10 @@ namespace detection
             fprintf(stdout, "%2d: %3.0f%%, [%4.0f, %4.0f, %4.0f, %4.0f], %s\n", obj.label, obj.prob * 100, obj.rect.x,
                     obj.rect.y, obj.rect.x + obj.rect.width, obj.rect.y + obj.rect.height, class_names[obj.label]);
 
-            mask(cv::Rect((int)obj.rect.x, (int)obj.rect.y, (int)objects[i].rect.width, (int)objects[i].rect.height)).setTo(color, objects[i].mask);
+            if (bitmasks)
+                mask::draw_bitmask(mask, (*bitmasks)[i], cv::Scalar(color[0], color[1], color[2]), 1.f);
+            else
+                mask(cv::Rect((int)obj.rect.x, (int)obj.rect.y, (int)objects[i].rect.width, (int)objects[i].rect.height)).setTo(color, objects[i].mask);
 
             cv::rectangle(image, obj.rect, cv::Scalar(255, 0, 0));
 
@@ -1997,56 +2259,23 @@ namespace detection
         cv::imwrite(std::string(output_name) + ".jpg", image);
     }
 
-    void reverse_letterbox(std::vector<Object>& proposal, std::vector<Object>& objects, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    void reverse_letterbox(std::vector<Object>& proposal, std::vector<Object>& objects, const LetterboxTransform& lb)
     {
-        float scale_letterbox;
-        int resize_rows;
-        int resize_cols;
-        if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
-        {
-            scale_letterbox = letterbox_rows * 1.0 / src_rows;
-        }
-        else
-        {
-            scale_letterbox = letterbox_cols * 1.0 / src_cols;
-        }
-        resize_cols = int(scale_letterbox * src_cols);
-        resize_rows = int(scale_letterbox * src_rows);
-
-        int tmp_h = (letterbox_rows - resize_rows) / 2;
-        int tmp_w = (letterbox_cols - resize_cols) / 2;
-
-        float ratio_x = (float)src_rows / resize_rows;
-        float ratio_y = (float)src_cols / resize_cols;
-
         int count = proposal.size();
 
         objects.resize(count);
         for (int i = 0; i < count; i++)
         {
             objects[i] = proposal[i];
-            float x0 = (objects[i].rect.x);
-            float y0 = (objects[i].rect.y);
-            float x1 = (objects[i].rect.x + objects[i].rect.width);
-            float y1 = (objects[i].rect.y + objects[i].rect.height);
-
-            x0 = (x0 - tmp_w) * ratio_x;
-            y0 = (y0 - tmp_h) * ratio_y;
-            x1 = (x1 - tmp_w) * ratio_x;
-            y1 = (y1 - tmp_h) * ratio_y;
-
-            x0 = std::max(std::min(x0, (float)(src_cols - 1)), 0.f);
-            y0 = std::max(std::min(y0, (float)(src_rows - 1)), 0.f);
-            x1 = std::max(std::min(x1, (float)(src_cols - 1)), 0.f);
-            y1 = std::max(std::min(y1, (float)(src_rows - 1)), 0.f);
-
-            objects[i].rect.x = x0;
-            objects[i].rect.y = y0;
-            objects[i].rect.width = x1 - x0;
-            objects[i].rect.height = y1 - y0;
+            lb.map_rect(objects[i].rect);
         }
     }
 
+    void reverse_letterbox(std::vector<Object>& proposal, std::vector<Object>& objects, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    {
+        reverse_letterbox(proposal, objects, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols));
+    }
+
     void get_out_bbox_no_letterbox(std::vector<Object>& proposals, std::vector<Object>& objects, const float nms_threshold, int model_h, int model_w, int src_rows, int src_cols)
     {
         qsort_descent_inplace(proposals);
@@ -2085,165 +2314,96 @@ namespace detection
         }
     }
 
-    void get_out_bbox(std::vector<Object>& objects, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    void get_out_bbox(std::vector<Object>& objects, const LetterboxTransform& lb)
     {
-        /* yolov5 draw the result */
-        float scale_letterbox;
-        int resize_rows;
-        int resize_cols;
-        if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
-        {
-            scale_letterbox = letterbox_rows * 1.0 / src_rows;
-        }
-        else
-        {
-            scale_letterbox = letterbox_cols * 1.0 / src_cols;
-        }
-        resize_cols = int(scale_letterbox * src_cols);
-        resize_rows = int(scale_letterbox * src_rows);
-
-        int tmp_h = (letterbox_rows - resize_rows) / 2;
-        int tmp_w = (letterbox_cols - resize_cols) / 2;
-
-        float ratio_x = (float)src_rows / resize_rows;
-        float ratio_y = (float)src_cols / resize_cols;
-
         int count = objects.size();
 
-        objects.resize(count);
         for (int i = 0; i < count; i++)
         {
-            float x0 = (objects[i].rect.x);
-            float y0 = (objects[i].rect.y);
-            float x1 = (objects[i].rect.x + objects[i].rect.width);
-            float y1 = (objects[i].rect.y + objects[i].rect.height);
-
-            x0 = (x0 - tmp_w) * ratio_x;
-            y0 = (y0 - tmp_h) * ratio_y;
-            x1 = (x1 - tmp_w) * ratio_x;
-            y1 = (y1 - tmp_h) * ratio_y;
-
+            lb.map_rect(objects[i].rect);
             for (int l = 0; l < 5; l++)
             {
-                auto lx = objects[i].landmark[l].x;
-                auto ly = objects[i].landmark[l].y;
-                objects[i].landmark[l] = cv::Point2f((lx - tmp_w) * ratio_x, (ly - tmp_h) * ratio_y);
+                objects[i].landmark[l] = lb.map_point(objects[i].landmark[l]);
             }
-
-            x0 = std::max(std::min(x0, (float)(src_cols - 1)), 0.f);
-            y0 = std::max(std::min(y0, (float)(src_rows - 1)), 0.f);
-            x1 = std::max(std::min(x1, (float)(src_cols - 1)), 0.f);
-            y1 = std::max(std::min(y1, (float)(src_rows - 1)), 0.f);
-
-            objects[i].rect.x = x0;
-            objects[i].rect.y = y0;
-            objects[i].rect.width = x1 - x0;
-            objects[i].rect.height = y1 - y0;
         }
     }
 
-    void get_out_bbox(std::vector<Object>& proposals, std::vector<Object>& objects, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    void get_out_bbox(std::vector<Object>& objects, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    {
+        get_out_bbox(objects, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols));
+    }
+
+    /* for proposals a decoder already mapped with lb, the survivors are only clipped */
+    void get_out_bbox_mapped(std::vector<Object>& proposals, std::vector<Object>& objects, const float nms_threshold, const LetterboxTransform& lb)
     {
         qsort_descent_inplace(proposals);
         std::vector<int> picked;
         nms_sorted_bboxes(proposals, picked, nms_threshold);
 
-        /* yolov5 draw the result */
-        float scale_letterbox;
-        int resize_rows;
-        int resize_cols;
-        if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
-        {
-            scale_letterbox = letterbox_rows * 1.0 / src_rows;
-        }
-        else
-        {
-            scale_letterbox = letterbox_cols * 1.0 / src_cols;
-        }
-        resize_cols = int(scale_letterbox * src_cols);
-        resize_rows = int(scale_letterbox * src_rows);
-
-        int tmp_h = (letterbox_rows - resize_rows) / 2;
-        int tmp_w = (letterbox_cols - resize_cols) / 2;
-
-        float ratio_x = (float)src_rows / resize_rows;
-        float ratio_y = (float)src_cols / resize_cols;
-
         int count = picked.size();
 
         objects.resize(count);
         for (int i = 0; i < count; i++)
         {
             objects[i] = proposals[picked[i]];
-            float x0 = (objects[i].rect.x);
-            float y0 = (objects[i].rect.y);
-            float x1 = (objects[i].rect.x + objects[i].rect.width);
-            float y1 = (objects[i].rect.y + objects[i].rect.height);
-
-            x0 = (x0 - tmp_w) * ratio_x;
-            y0 = (y0 - tmp_h) * ratio_y;
-            x1 = (x1 - tmp_w) * ratio_x;
-            y1 = (y1 - tmp_h) * ratio_y;
-
-            for (int l = 0; l < 5; l++)
-            {
-                auto lx = objects[i].landmark[l].x;
-                auto ly = objects[i].landmark[l].y;
-                objects[i].landmark[l] = cv::Point2f((lx - tmp_w) * ratio_x, (ly - tmp_h) * ratio_y);
-            }
-
-            x0 = std::max(std::min(x0, (float)(src_cols - 1)), 0.f);
-            y0 = std::max(std::min(y0, (float)(src_rows - 1)), 0.f);
-            x1 = std::max(std::min(x1, (float)(src_cols - 1)), 0.f);
-            y1 = std::max(std::min(y1, (float)(src_rows - 1)), 0.f);
-
-            objects[i].rect.x = x0;
-            objects[i].rect.y = y0;
-            objects[i].rect.width = x1 - x0;
-            objects[i].rect.height = y1 - y0;
+            lb.clip_rect(objects[i].rect);
         }
     }
 
-    void get_out_bbox_mask(std::vector<Object>& proposals, std::vector<Object>& objects, const float* mask_proto, int mask_proto_dim, int mask_stride, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    void get_out_bbox(std::vector<Object>& proposals, std::vector<Object>& objects, const float nms_threshold, const LetterboxTransform& lb)
     {
         qsort_descent_inplace(proposals);
         std::vector<int> picked;
         nms_sorted_bboxes(proposals, picked, nms_threshold);
 
-        /* yolov5 draw the result */
-        float scale_letterbox;
-        int resize_rows;
-        int resize_cols;
-        if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
-        {
-            scale_letterbox = letterbox_rows * 1.0 / src_rows;
-        }
-        else
+        int count = picked.size();
+
+        objects.resize(count);
+        for (int i = 0; i < count; i++)
         {
-            scale_letterbox = letterbox_cols * 1.0 / src_cols;
+            objects[i] = proposals[picked[i]];
+            lb.map_rect(objects[i].rect);
+            for (int l = 0; l < 5; l++)
+            {
+                objects[i].landmark[l] = lb.map_point(objects[i].landmark[l]);
+            }
         }
-        resize_cols = int(scale_letterbox * src_cols);
-        resize_rows = int(scale_letterbox * src_rows);
+    }
 
-        int tmp_h = (letterbox_rows - resize_rows) / 2;
-        int tmp_w = (letterbox_cols - resize_cols) / 2;
+    void get_out_bbox(std::vector<Object>& proposals, std::vector<Object>& objects, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    {
+        get_out_bbox(proposals, objects, nms_threshold, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols));
+    }
 
-        float ratio_x = (float)src_rows / resize_rows;
-        float ratio_y = (float)src_cols / resize_cols;
+    /*
+     * masks and source coordinates for objects that already went through NMS.
+     * When bitmasks is given the masks are bit-packed into it, one per object,
+     * and objects[i].mask is left empty.
+     */
+    void get_out_bbox_mask(std::vector<Object>& objects, const float* mask_proto, int mask_proto_dim, int mask_stride, const LetterboxTransform& lb, std::vector<mask::BitMask>* bitmasks = nullptr)
+    {
+        int mask_proto_h = int(lb.letterbox_rows / mask_stride);
+        int mask_proto_w = int(lb.letterbox_cols / mask_stride);
 
-        int mask_proto_h = int(letterbox_rows / mask_stride);
-        int mask_proto_w = int(letterbox_cols / mask_stride);
+        int count = objects.size();
+        if (bitmasks)
+            bitmasks->resize(count);
 
-        int count = picked.size();
-        objects.resize(count);
+        /* mask logits of every object in one GEMM, (count x dim) * (dim x proto_h * proto_w) */
+        cv::Mat mask_logits;
+        if (count > 0)
+        {
+            cv::Mat mask_coeffs(count, mask_proto_dim, CV_32FC1);
+            for (int i = 0; i < count; i++)
+            {
+                memcpy(mask_coeffs.ptr<float>(i), objects[i].mask_feat.data(), sizeof(float) * mask_proto_dim);
+            }
+            cv::Mat mask_protos = cv::Mat(mask_proto_dim, mask_proto_h * mask_proto_w, CV_32FC1, (float*)mask_proto);
+            cv::gemm(mask_coeffs, mask_protos, 1.0, cv::noArray(), 0.0, mask_logits);
+        }
 
         for (int i = 0; i < count; i++)
         {
-            objects[i] = proposals[picked[i]];
-            float x0 = (objects[i].rect.x);
-            float y0 = (objects[i].rect.y);
-            float x1 = (objects[i].rect.x + objects[i].rect.width);
-            float y1 = (objects[i].rect.y + objects[i].rect.height);
             /* naive RoiAlign by opencv */
             int hstart = std::floor(objects[i].rect.y / mask_stride);
             int hend = std::ceil(objects[i].rect.y / mask_stride + objects[i].rect.height / mask_stride);
@@ -2258,108 +2418,205 @@ namespace detection
             int mask_w = wend - wstart;
             int mask_h = hend - hstart;
 
-            cv::Mat mask = cv::Mat(mask_h, mask_w, CV_32FC1);
-            if (mask_w > 0 && mask_h > 0)
-            {
-                std::vector<cv::Range> roi_ranges;
-                roi_ranges.push_back(cv::Range(0, 1));
-                roi_ranges.push_back(cv::Range::all());
-                roi_ranges.push_back(cv::Range(hstart, hend));
-                roi_ranges.push_back(cv::Range(wstart, wend));
+            lb.map_rect(objects[i].rect);
 
-                cv::Mat mask_protos = cv::Mat(mask_proto_dim, mask_proto_h * mask_proto_w, CV_32FC1, (float*)mask_proto);
-                int sz[] = {1, mask_proto_dim, mask_proto_h, mask_proto_w};
-                cv::Mat mask_protos_reshape = mask_protos.reshape(1, 4, sz);
-                cv::Mat protos = mask_protos_reshape(roi_ranges).clone().reshape(0, {mask_proto_dim, mask_w * mask_h});
-                cv::Mat mask_proposals = cv::Mat(1, mask_proto_dim, CV_32FC1, (float*)objects[i].mask_feat.data());
-                cv::Mat masks_feature = (mask_proposals * protos);
-                /* sigmoid */
-                cv::exp(-masks_feature.reshape(1, {mask_h, mask_w}), mask);
-                mask = 1.0 / (1.0 + mask);
+            int box_w = (int)objects[i].rect.width;
+            int box_h = (int)objects[i].rect.height;
+            if (mask_w > 0 && mask_h > 0 && box_w > 0 && box_h > 0)
+            {
+                /* crop, resize the logits, then binarize: sigmoid(x) > 0.5 is x > 0, so no sigmoid */
+                cv::Mat mask_roi = mask_logits.row(i).reshape(1, mask_proto_h)(cv::Rect(wstart, hstart, mask_w, mask_h));
+                cv::Mat mask;
+                cv::resize(mask_roi, mask, cv::Size(box_w, box_h));
+                if (bitmasks)
+                    mask::encode_bitmask(mask, (int)objects[i].rect.x, (int)objects[i].rect.y, (*bitmasks)[i]);
+                else
+                    objects[i].mask = mask > 0.f;
+            }
+            else if (bitmasks)
+            {
+                mask::clear_bitmask((int)objects[i].rect.x, (int)objects[i].rect.y, box_w, box_h, (*bitmasks)[i]);
+            }
+            else
+            {
+                objects[i].mask = cv::Mat::zeros(std::max(box_h, 0), std::max(box_w, 0), CV_8UC1);
             }
+        }
+    }
 
-            x0 = (x0 - tmp_w) * ratio_x;
-            y0 = (y0 - tmp_h) * ratio_y;
-            x1 = (x1 - tmp_w) * ratio_x;
-            y1 = (y1 - tmp_h) * ratio_y;
+    void get_out_bbox_mask(std::vector<Object>& objects, const float* mask_proto, int mask_proto_dim, int mask_stride, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols, std::vector<mask::BitMask>* bitmasks = nullptr)
+    {
+        get_out_bbox_mask(objects, mask_proto, mask_proto_dim, mask_stride, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols), bitmasks);
+    }
 
-            x0 = std::max(std::min(x0, (float)(src_cols - 1)), 0.f);
-            y0 = std::max(std::min(y0, (float)(src_rows - 1)), 0.f);
-            x1 = std::max(std::min(x1, (float)(src_cols - 1)), 0.f);
-            y1 = std::max(std::min(y1, (float)(src_rows - 1)), 0.f);
+    void get_out_bbox_mask(std::vector<Object>& proposals, std::vector<Object>& objects, const float* mask_proto, int mask_proto_dim, int mask_stride, const float nms_threshold, const LetterboxTransform& lb, std::vector<mask::BitMask>* bitmasks = nullptr)
+    {
+        qsort_descent_inplace(proposals);
+        std::vector<int> picked;
+        nms_sorted_bboxes(proposals, picked, nms_threshold);
 
-            objects[i].rect.x = x0;
-            objects[i].rect.y = y0;
-            objects[i].rect.width = x1 - x0;
-            objects[i].rect.height = y1 - y0;
-            cv::resize(mask, mask, cv::Size((int)objects[i].rect.width, (int)objects[i].rect.height));
-            objects[i].mask = mask > 0.5;
+        int count = picked.size();
+        objects.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            objects[i] = proposals[picked[i]];
         }
+        get_out_bbox_mask(objects, mask_proto, mask_proto_dim, mask_stride, lb, bitmasks);
     }
 
-    void get_out_bbox_kps(std::vector<Object>& proposals, std::vector<Object>& objects, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    void get_out_bbox_mask(std::vector<Object>& proposals, std::vector<Object>& objects, const float* mask_proto, int mask_proto_dim, int mask_stride, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols, std::vector<mask::BitMask>* bitmasks = nullptr)
     {
-        qsort_descent_inplace(proposals);
+        get_out_bbox_mask(proposals, objects, mask_proto, mask_proto_dim, mask_stride, nms_threshold, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols), bitmasks);
+    }
+
+    /* sort and NMS run on the compact records, only the survivors become Objects */
+    void get_out_bbox_mask(ProposalBuffer& proposals, std::vector<Object>& objects, const float* mask_proto, int mask_proto_dim, int mask_stride, const float nms_threshold, const LetterboxTransform& lb, std::vector<mask::BitMask>* bitmasks = nullptr)
+    {
+        qsort_descent_inplace(proposals.records);
         std::vector<int> picked;
-        nms_sorted_bboxes(proposals, picked, nms_threshold);
+        nms_sorted_bboxes(proposals.records, picked, nms_threshold);
 
-        /* yolov8 draw the result */
-        float scale_letterbox;
-        int resize_rows;
-        int resize_cols;
-        if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
+        int count = picked.size();
+        objects.resize(count);
+        for (int i = 0; i < count; i++)
         {
-            scale_letterbox = letterbox_rows * 1.0 / src_rows;
+            proposals.to_object(proposals.records[picked[i]], objects[i]);
         }
-        else
+        get_out_bbox_mask(objects, mask_proto, mask_proto_dim, mask_stride, lb, bitmasks);
+    }
+
+    void get_out_bbox_mask(ProposalBuffer& proposals, std::vector<Object>& objects, const float* mask_proto, int mask_proto_dim, int mask_stride, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols, std::vector<mask::BitMask>* bitmasks = nullptr)
+    {
+        get_out_bbox_mask(proposals, objects, mask_proto, mask_proto_dim, mask_stride, nms_threshold, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols), bitmasks);
+    }
+
+    /* source coordinates of boxes and keypoints for objects that already went through NMS */
+    void get_out_bbox_kps(std::vector<Object>& objects, const LetterboxTransform& lb)
+    {
+        int count = objects.size();
+
+        for (int i = 0; i < count; i++)
         {
-            scale_letterbox = letterbox_cols * 1.0 / src_cols;
+            lb.map_rect(objects[i].rect);
+            lb.map_kps(objects[i].kps_feat.data(), (int)objects[i].kps_feat.size() / 3);
         }
-        resize_cols = int(scale_letterbox * src_cols);
-        resize_rows = int(scale_letterbox * src_rows);
+    }
 
-        int tmp_h = (letterbox_rows - resize_rows) / 2;
-        int tmp_w = (letterbox_cols - resize_cols) / 2;
+    void get_out_bbox_kps(std::vector<Object>& objects, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    {
+        get_out_bbox_kps(objects, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols));
+    }
 
-        float ratio_x = (float)src_rows / resize_rows;
-        float ratio_y = (float)src_cols / resize_cols;
+    void get_out_bbox_kps(std::vector<Object>& proposals, std::vector<Object>& objects, const float nms_threshold, const LetterboxTransform& lb)
+    {
+        qsort_descent_inplace(proposals);
+        std::vector<int> picked;
+        nms_sorted_bboxes(proposals, picked, nms_threshold);
 
         int count = picked.size();
-
         objects.resize(count);
         for (int i = 0; i < count; i++)
         {
             objects[i] = proposals[picked[i]];
-            float x0 = (objects[i].rect.x);
-            float y0 = (objects[i].rect.y);
-            float x1 = (objects[i].rect.x + objects[i].rect.width);
-            float y1 = (objects[i].rect.y + objects[i].rect.height);
+        }
+        get_out_bbox_kps(objects, lb);
+    }
 
-            x0 = (x0 - tmp_w) * ratio_x;
-            y0 = (y0 - tmp_h) * ratio_y;
-            x1 = (x1 - tmp_w) * ratio_x;
-            y1 = (y1 - tmp_h) * ratio_y;
+    void get_out_bbox_kps(std::vector<Object>& proposals, std::vector<Object>& objects, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    {
+        get_out_bbox_kps(proposals, objects, nms_threshold, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols));
+    }
 
-            x0 = std::max(std::min(x0, (float)(src_cols - 1)), 0.f);
-            y0 = std::max(std::min(y0, (float)(src_rows - 1)), 0.f);
-            x1 = std::max(std::min(x1, (float)(src_cols - 1)), 0.f);
-            y1 = std::max(std::min(y1, (float)(src_rows - 1)), 0.f);
+    /* sort and NMS run on the compact records, only the survivors become Objects */
+    void get_out_bbox_kps(ProposalBuffer& proposals, std::vector<Object>& objects, const float nms_threshold, const LetterboxTransform& lb)
+    {
+        qsort_descent_inplace(proposals.records);
+        std::vector<int> picked;
+        nms_sorted_bboxes(proposals.records, picked, nms_threshold);
 
-            objects[i].rect.x = x0;
-            objects[i].rect.y = y0;
-            objects[i].rect.width = x1 - x0;
-            objects[i].rect.height = y1 - y0;
+        int count = picked.size();
+        objects.resize(count);
+        for (int i = 0; i < count; i++)
+        {
+            proposals.to_object(proposals.records[picked[i]], objects[i]);
+        }
+        get_out_bbox_kps(objects, lb);
+    }
+
+    void get_out_bbox_kps(ProposalBuffer& proposals, std::vector<Object>& objects, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    {
+        get_out_bbox_kps(proposals, objects, nms_threshold, LetterboxTransform(letterbox_rows, letterbox_cols, src_rows, src_cols));
+    }
 
-            for (int j = 0; j < objects[i].kps_feat.size() / 3; j++)
+    /* same as above on reused buffers, the results land in ctx.objects */
+    void get_out_bbox_kps(PostProcessContext& ctx, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    {
+        qsort_descent_inplace(ctx.proposals.records);
+        nms_sorted_bboxes(ctx.proposals.records, ctx.picked, ctx.areas, nms_threshold);
+
+        const LetterboxTransform& lb = ctx.letterbox_for(letterbox_rows, letterbox_cols, src_rows, src_cols);
+        int count = ctx.picked.size();
+        ctx.resize_objects(count);
+        for (int i = 0; i < count; i++)
+        {
+            Object& obj = ctx.objects[i];
+            ctx.proposals.to_object(ctx.proposals.records[ctx.picked[i]], obj);
+            lb.map_rect(obj.rect);
+            lb.map_kps(obj.kps_feat.data(), (int)obj.kps_feat.size() / 3);
+        }
+    }
+
+    /* plain detection: ctx.object_proposals in, ctx.objects out, no per frame allocation */
+    void get_out_bbox(PostProcessContext& ctx, const float nms_threshold, int letterbox_rows, int letterbox_cols, int src_rows, int src_cols)
+    {
+        qsort_descent_inplace(ctx.object_proposals);
+        nms_sorted_bboxes(ctx.object_proposals, ctx.picked, ctx.areas, nms_threshold);
+
+        const LetterboxTransform& lb = ctx.letterbox_for(letterbox_rows, letterbox_cols, src_rows, src_cols);
+        int count = ctx.picked.size();
+        ctx.resize_objects(count);
+        for (int i = 0; i < count; i++)
+        {
+            Object& obj = ctx.objects[i];
+            obj = ctx.object_proposals[ctx.picked[i]];
+            lb.map_rect(obj.rect);
+            for (int l = 0; l < 5; l++)
             {
-                objects[i].kps_feat[j * 3] = std::max(
-                    std::min((objects[i].kps_feat[j * 3] - tmp_w) * ratio_x, (float)(src_cols - 1)), 0.f);
-                objects[i].kps_feat[j * 3 + 1] = std::max(
-                    std::min((objects[i].kps_feat[j * 3 + 1] - tmp_h) * ratio_y, (float)(src_rows - 1)), 0.f);
+                obj.landmark[l] = lb.map_point(obj.landmark[l]);
             }
         }
     }
 
+    /* for Objects the decoder already mapped with ctx.letterbox, the survivors are only clipped */
+    void get_out_bbox_mapped(PostProcessContext& ctx, const float nms_threshold)
+    {
+        qsort_descent_inplace(ctx.object_proposals);
+        nms_sorted_bboxes(ctx.object_proposals, ctx.picked, ctx.areas, nms_threshold);
+
+        int count = ctx.picked.size();
+        ctx.resize_objects(count);
+        for (int i = 0; i < count; i++)
+        {
+            ctx.objects[i] = ctx.object_proposals[ctx.picked[i]];
+            ctx.letterbox.clip_rect(ctx.objects[i].rect);
+        }
+    }
+
+    /* for proposals the decoder already mapped with ctx.letterbox, the survivors are only clipped */
+    void get_out_bbox_kps_mapped(PostProcessContext& ctx, const float nms_threshold)
+    {
+        qsort_descent_inplace(ctx.proposals.records);
+        nms_sorted_bboxes(ctx.proposals.records, ctx.picked, ctx.areas, nms_threshold);
+
+        int count = ctx.picked.size();
+        ctx.resize_objects(count);
+        for (int i = 0; i < count; i++)
+        {
+            ctx.proposals.to_object(ctx.proposals.records[ctx.picked[i]], ctx.objects[i]);
+            ctx.letterbox.clip_rect(ctx.objects[i].rect);
+        }
+    }
+
     static void transform_rects_palm(PalmObject& object)
     {
         float x0 = object.landmarks[0].x;
@@ -2423,38 +2680,19 @@ namespace detection
             transform_rects_palm(objects[i]);
         }
 
-        float scale_letterbox;
-        int resize_rows;
-        int resize_cols;
-        if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
-        {
-            scale_letterbox = letterbox_rows * 1.0 / src_rows;
-        }
-        else
-        {
-            scale_letterbox = letterbox_cols * 1.0 / src_cols;
-        }
-        resize_cols = int(scale_letterbox * src_cols);
-        resize_rows = int(scale_letterbox * src_rows);
-
-        int tmp_h = (letterbox_rows - resize_rows) / 2;
-        int tmp_w = (letterbox_cols - resize_cols) / 2;
-
-        float ratio_x = (float)src_cols / resize_cols;
-        float ratio_y = (float)src_rows / resize_rows;
+        const LetterboxTransform lb(letterbox_rows, letterbox_cols, src_rows, src_cols);
 
         for (auto& object : objects)
         {
+            /* palm coordinates are normalized to the letterbox */
             for (auto& vertice : object.vertices)
             {
-                vertice.x = (vertice.x * letterbox_cols - tmp_w) * ratio_x;
-                vertice.y = (vertice.y * letterbox_rows - tmp_h) * ratio_y;
+                vertice = lb.map_point(cv::Point2f(vertice.x * letterbox_cols, vertice.y * letterbox_rows));
             }
 
             for (auto& ld : object.landmarks)
             {
-                ld.x = (ld.x * letterbox_cols - tmp_w) * ratio_x;
-                ld.y = (ld.y * letterbox_rows - tmp_h) * ratio_y;
+                ld = lb.map_point(cv::Point2f(ld.x * letterbox_cols, ld.y * letterbox_rows));
             }
             // get warpaffine transform mat to landmark detect
             cv::Point2f src_pts[4];
@@ -2480,26 +2718,7 @@ namespace detection
         std::vector<int> picked;
         nms_sorted_bboxes(proposals, picked, nms_threshold);
 
-        /* yolov5 draw the result */
-        float scale_letterbox;
-        int resize_rows;
-        int resize_cols;
-        if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
-        {
-            scale_letterbox = letterbox_rows * 1.0 / src_rows;
-        }
-        else
-        {
-            scale_letterbox = letterbox_cols * 1.0 / src_cols;
-        }
-        resize_cols = int(scale_letterbox * src_cols);
-        resize_rows = int(scale_letterbox * src_rows);
-
-        int tmp_h = (letterbox_rows - resize_rows) / 2;
-        int tmp_w = (letterbox_cols - resize_cols) / 2;
-
-        float ratio_x = (float)src_rows / resize_rows;
-        float ratio_y = (float)src_cols / resize_cols;
+        const LetterboxTransform lb(letterbox_rows, letterbox_cols, src_rows, src_cols);
 
         int count = picked.size();
 
@@ -2507,34 +2726,18 @@ namespace detection
         for (int i = 0; i < count; i++)
         {
             objects[i] = proposals[picked[i]];
-            float x0 = (objects[i].rect.x);
-            float y0 = (objects[i].rect.y);
-            float x1 = (objects[i].rect.x + objects[i].rect.width);
-            float y1 = (objects[i].rect.y + objects[i].rect.height);
-
-            x0 = (x0 - tmp_w) * ratio_x;
-            y0 = (y0 - tmp_h) * ratio_y;
-            x1 = (x1 - tmp_w) * ratio_x;
-            y1 = (y1 - tmp_h) * ratio_y;
-
-            x0 = std::max(std::min(x0, (float)(src_cols - 1)), 0.f);
-            y0 = std::max(std::min(y0, (float)(src_rows - 1)), 0.f);
-            x1 = std::max(std::min(x1, (float)(src_cols - 1)), 0.f);
-            y1 = std::max(std::min(y1, (float)(src_rows - 1)), 0.f);
-
-            objects[i].rect.x = x0;
-            objects[i].rect.y = y0;
-            objects[i].rect.width = x1 - x0;
-            objects[i].rect.height = y1 - y0;
+            lb.map_rect(objects[i].rect);
         }
 
-        cv::Mat ll = cv::Mat(cv::Size(letterbox_cols, letterbox_rows), CV_32FC1, (float*)ll_ptr);
-        ll = ll > 0.5;
-        cv::resize(ll(cv::Rect(tmp_w, tmp_h, resize_cols, resize_rows)), ll_seg_mask, cv::Size(src_cols, src_rows), 0, 0, cv::INTER_LINEAR);
+        /* only the image part of the letterbox is thresholded and upsampled */
+        const cv::Rect roi(lb.pad_x, lb.pad_y, lb.resize_cols, lb.resize_rows);
 
-        cv::Mat da = cv::Mat(cv::Size(letterbox_cols, letterbox_rows), CV_32FC1, (float*)da_ptr);
-        da = da > 0;
-        cv::resize(da(cv::Rect(tmp_w, tmp_h, resize_cols, resize_rows)), da_seg_mask, cv::Size(src_cols, src_rows), 0, 0, cv::INTER_NEAREST);
+        /* lane lines are a few pixels wide, linear upsampling keeps them connected */
+        cv::Mat ll = cv::Mat(cv::Size(letterbox_cols, letterbox_rows), CV_32FC1, (float*)ll_ptr)(roi) > 0.5;
+        cv::resize(ll, ll_seg_mask, cv::Size(src_cols, src_rows), 0, 0, cv::INTER_LINEAR);
+
+        cv::Mat da = cv::Mat(cv::Size(letterbox_cols, letterbox_rows), CV_32FC1, (float*)da_ptr)(roi) > 0;
+        segmentation::resize_labels(da, cv::Size(src_cols, src_rows), da_seg_mask);
     }
 
     namespace mmyolo
@@ -2549,18 +2752,18 @@ namespace detection
 
         inline float fast_exp(const float& x)
         {
-            union
-            {
-                uint32_t i;
-                float f;
-            } v{};
-            v.i = (1 << 23) * (1.4426950409 * x + 126.93490512f);
-            return v.f;
+            return fast_math::exp_bithack(x);
         }
 
         inline float fast_sigmoid(const float& x)
         {
-            return 1.0f / (1.0f + fast_exp(-x));
+            return fast_math::sigmoid_bithack(x);
+        }
+
+        /* fast_exp() stays within [-4.5%, +1.5%] of exp(), widen the logit cut to match */
+        inline static float fast_unsigmoid(float prob)
+        {
+            return unsigmoid(prob) - 0.05f;
         }
 
         inline static float fast_softmax(
@@ -2568,17 +2771,10 @@ namespace detection
             float* dst,
             int length)
         {
-            const float alpha = *std::max_element(src, src + length);
-            float denominator = 0;
+            fast_math::softmax(src, dst, length, fast_math::PRECISION_BITHACK);
             float dis_sum = 0;
             for (int i = 0; i < length; ++i)
             {
-                dst[i] = fast_exp(src[i] - alpha);
-                denominator += dst[i];
-            }
-            for (int i = 0; i < length; ++i)
-            {
-                dst[i] /= denominator;
                 dis_sum += i * dst[i];
             }
             return dis_sum;
@@ -2598,6 +2794,7 @@ namespace detection
             int feat_h = letterbox_rows / stride;
             auto cls_ptr = cls_feat;
             auto boxes_ptr = box_feat;
+            const float prob_threshold_unsigmoid = fast_unsigmoid(prob_threshold);
             int reg_max = 17;
             float dis_after_sm[reg_max];
 
@@ -2606,7 +2803,7 @@ namespace detection
                 for (int w = 0; w < feat_w; w++)
                 {
                     auto max = std::max_element(cls_ptr, cls_ptr + cls_num);
-                    float box_prob = fast_sigmoid(*max);
+                    float box_prob = *max < prob_threshold_unsigmoid ? 0.f : fast_sigmoid(*max);
 
                     if (box_prob > prob_threshold)
                     {
@@ -2656,15 +2853,23 @@ namespace detection
             int feat_h = letterbox_rows / stride;
             auto cls_ptr = cls_feat;
             auto boxes_ptr = box_feat;
+            const float prob_threshold_unsigmoid = fast_unsigmoid(prob_threshold);
             auto conf_ptr = conf_feat;
 
             for (int h = 0; h < feat_h; h++)
             {
                 for (int w = 0; w < feat_w; w++)
                 {
-                    //process cls score
-                    auto max = std::max_element(cls_ptr, cls_ptr + cls_num);
-                    float box_prob = fast_sigmoid(*max) * fast_sigmoid(*conf_ptr);
+                    /* objectness first, the class scan only runs for survivors */
+                    float box_prob = 0.f;
+                    auto max = cls_ptr;
+                    if (*conf_ptr >= prob_threshold_unsigmoid)
+                    {
+                        //process cls score
+                        max = std::max_element(cls_ptr, cls_ptr + cls_num);
+                        if (*max >= prob_threshold_unsigmoid)
+                            box_prob = fast_sigmoid(*max) * fast_sigmoid(*conf_ptr);
+                    }
 
                     if (box_prob > prob_threshold)
                     {
@@ -2711,6 +2916,7 @@ namespace detection
             int feat_h = letterbox_rows / stride;
             auto cls_ptr = cls_feat;
             auto boxes_ptr = box_feat;
+            const float prob_threshold_unsigmoid = fast_unsigmoid(prob_threshold);
 
             for (int h = 0; h < feat_h; h++)
             {
@@ -2718,7 +2924,7 @@ namespace detection
                 {
                     //process cls score
                     auto max = std::max_element(cls_ptr, cls_ptr + cls_num);
-                    float box_prob = fast_sigmoid(*max);
+                    float box_prob = *max < prob_threshold_unsigmoid ? 0.f : fast_sigmoid(*max);
 
                     if (box_prob > prob_threshold)
                     {
@@ -2762,6 +2968,7 @@ namespace detection
             int feat_h = letterbox_rows / stride;
             auto cls_ptr = cls_feat;
             auto boxes_ptr = box_feat;
+            const float prob_threshold_unsigmoid = fast_unsigmoid(prob_threshold);
             int reg_max = 16;
             float dis_after_sm[reg_max];
 
@@ -2770,7 +2977,7 @@ namespace detection
                 for (int w = 0; w < feat_w; w++)
                 {
                     auto max = std::max_element(cls_ptr, cls_ptr + cls_num);
-                    float box_prob = fast_sigmoid(*max);
+                    float box_prob = *max < prob_threshold_unsigmoid ? 0.f : fast_sigmoid(*max);
 
                     if (box_prob > prob_threshold)
                     {
@@ -2810,13 +3017,7 @@ namespace detection
     {
         static inline float fast_exp(const float& x)
         {
-            union
-            {
-                uint32_t i;
-                float f;
-            } v;
-            v.i = (1 << 23) * (1.4426950409 * x + 126.93490512f);
-            return v.f;
+            return fast_math::exp_bithack(x);
         }
 
         static inline float clamp_(float v, float min = 0.f, float max = std::numeric_limits<float>::infinity())
@@ -2846,74 +3047,171 @@ namespace detection
 
         static inline float fast_log2 (float x)
         {
-            union {
-                float f; 
-                int i;
-            } v;
-            v.f = x;
-            int* const exp_ptr = &v.i;
-            int m  = *exp_ptr;
-            const int log_2 = ((m >> 23) & 255) - 128;
-            m &= ~(255 << 23);
-            m += 127 << 23;
-            *exp_ptr = m;
-            return (((-1.f / 3) * v.f + 2) * v.f - 2.f / 3 + log_2);
+            return fast_math::log2_bithack(x);
         }
 
-        static inline float fast_log (const float x)
-        {
-            return 0.69314718f * fast_log2 (x);
-        }
-        
-        static inline float probiou(
-            const Object& obj1,
-            const Object& obj2,
-            const cv::Point3f& covar1,
-            const cv::Point3f& covar2)
+        /*
+         * Probiou with the fast_log2 / fast_exp approximations, the scalar twin
+         * of probiou_batch_any. Covariances are (a, b, c) and dem is the clamped
+         * determinant a * b - c * c of each box. The vector form evaluates the
+         * exp bit trick in float, fast_exp in double, so the two may differ in
+         * the last bits of the result.
+         */
+        static inline float probiou_f(float x1, float y1, const cv::Point3f& covar1, float dem1,
+                                      float x2, float y2, const cv::Point3f& covar2, float dem2)
         {
-            
-            float v_x1_x2 = covar1.x + covar2.x;
-            float v_y1_y2 = covar1.y + covar2.y;
-            float x1_x2 = obj1.rect.x - obj2.rect.x;
-            float y1_y2 = obj1.rect.y - obj2.rect.y;
-            float dem1 = clamp_(covar1.x * covar1.y - covar1.z * covar1.z);
-            float dem2 = clamp_(covar2.x * covar2.y - covar2.z * covar2.z);
-            float dem_num = v_x1_x2 * v_y1_y2 - (covar1.z + covar2.z) * (covar1.z + covar2.z);
-            
-            float t1 = (v_x1_x2 * y1_y2 * y1_y2 + v_y1_y2 * x1_x2 * x1_x2) / (dem_num + 1e-7) * 0.25f;
-            float t2 = ((covar1.z + covar2.z) * (-x1_x2) * y1_y2) / (dem_num + 1e-7) * 0.5f;
-            float t3 = fast_log(0.25f * dem_num / (std::sqrt(dem1 * dem2) + 1e-7) + 1e-7) * 0.5f;
-           
+            float vx = covar1.x + covar2.x;
+            float vy = covar1.y + covar2.y;
+            float vz = covar1.z + covar2.z;
+            float dx = x1 - x2;
+            float dy = y1 - y2;
+            float dem_num = vx * vy - vz * vz;
+            float den = dem_num + 1e-7f;
+
+            float t1 = (vx * dy * dy + vy * dx * dx) / den * 0.25f;
+            float t2 = (vz * -dx * dy) / den * 0.5f;
+            float t3 = 0.69314718f * fast_log2(0.25f * dem_num / (std::sqrt(dem1 * dem2) + 1e-7f) + 1e-7f) * 0.5f;
+
             float bd = t1 + t2 + t3;
-            float iou = fast_exp(-clamp_(bd, 1e-7, 100.f));
-            return iou;
+            return fast_exp(-clamp_(bd, 1e-7f, 100.f));
         }
 
+        /* kept boxes in SoA form, padded to whole vectors with boxes that never overlap */
+        typedef struct ProbiouBatch
+        {
+            std::vector<float> x, y, a, b, c, dem;
+            int count = 0;
+
+            void clear()
+            {
+                x.clear(), y.clear(), a.clear(), b.clear(), c.clear(), dem.clear();
+                count = 0;
+            }
+
+            void push(float x_, float y_, const cv::Point3f& covar, float dem_)
+            {
+                x.push_back(x_), y.push_back(y_);
+                a.push_back(covar.x), b.push_back(covar.y), c.push_back(covar.z);
+                dem.push_back(dem_);
+                count++;
+            }
+
+            void pad()
+            {
+                while (x.size() & 3)
+                    push(1e8f, 1e8f, cv::Point3f(1.f, 1.f, 0.f), 1.f);
+            }
+        } ProbiouBatch;
+
+        /* true when any box of the batch has probiou >= iou_threshold against box 1 */
+        static inline bool probiou_batch_any(float x1, float y1, const cv::Point3f& covar1, float dem1,
+                                             ProbiouBatch& batch, float iou_threshold)
+        {
+#if defined(AX_SAMPLES_SIMD)
+            batch.pad();
+            const int n = (int)batch.x.size();
+            const simd::v4f px = simd::set1(x1), py = simd::set1(y1);
+            const simd::v4f pa = simd::set1(covar1.x), pb = simd::set1(covar1.y), pc = simd::set1(covar1.z);
+            const simd::v4f pdem = simd::set1(dem1);
+            const simd::v4f thr = simd::set1(iou_threshold);
+            for (int j = 0; j < n; j += 4)
+            {
+                simd::v4f vx = simd::add(pa, simd::load(&batch.a[j]));
+                simd::v4f vy = simd::add(pb, simd::load(&batch.b[j]));
+                simd::v4f vz = simd::add(pc, simd::load(&batch.c[j]));
+                simd::v4f dx = simd::sub(px, simd::load(&batch.x[j]));
+                simd::v4f dy = simd::sub(py, simd::load(&batch.y[j]));
+                simd::v4f dem_num = simd::sub(simd::mul(vx, vy), simd::mul(vz, vz));
+                simd::v4f den = simd::add(dem_num, simd::set1(1e-7f));
+
+                simd::v4f t1 = simd::add(simd::mul(simd::mul(vx, dy), dy), simd::mul(simd::mul(vy, dx), dx));
+                t1 = simd::mul(simd::div(t1, den), simd::set1(0.25f));
+                simd::v4f t2 = simd::mul(simd::mul(vz, simd::sub(simd::set1(0.f), dx)), dy);
+                t2 = simd::mul(simd::div(t2, den), simd::set1(0.5f));
+
+                /* fast_log2 */
+                simd::v4f arg = simd::mul(simd::set1(0.25f), dem_num);
+                arg = simd::div(arg, simd::add(simd::sqrt(simd::mul(pdem, simd::load(&batch.dem[j]))), simd::set1(1e-7f)));
+                arg = simd::add(arg, simd::set1(1e-7f));
+                simd::v4i bits = simd::as_int(arg);
+                simd::v4i log_2 = simd::sub_int(simd::and_int(simd::shift_right<23>(bits), simd::set1_int(255)), simd::set1_int(128));
+                bits = simd::add_int(simd::and_int(bits, simd::set1_int(~(255 << 23))), simd::set1_int(127 << 23));
+                simd::v4f m = simd::as_float(bits);
+                simd::v4f l = simd::mul(simd::add(simd::mul(simd::set1(-1.f / 3), m), simd::set1(2.f)), m);
+                l = simd::add(simd::sub(l, simd::set1(2.f / 3)), simd::to_float(log_2));
+                simd::v4f t3 = simd::mul(simd::mul(simd::set1(0.69314718f), l), simd::set1(0.5f));
+
+                /* fast_exp(-clamp_(bd, 1e-7, 100)) */
+                simd::v4f bd = simd::add(simd::add(t1, t2), t3);
+                bd = simd::max(simd::min(bd, simd::set1(100.f)), simd::set1(1e-7f));
+                simd::v4f e = simd::add(simd::mul(simd::set1(1.4426950409f), simd::sub(simd::set1(0.f), bd)), simd::set1(126.93490512f));
+                e = simd::max(simd::mul(simd::set1((float)(1 << 23)), e), simd::set1(0.f));
+                simd::v4f iou = simd::as_float(simd::to_int(e));
+
+                if (simd::any_ge(iou, thr))
+                    return true;
+            }
+            return false;
+#else
+            for (int j = 0; j < batch.count; j++)
+            {
+                cv::Point3f covar2(batch.a[j], batch.b[j], batch.c[j]);
+                if (probiou_f(x1, y1, covar1, dem1, batch.x[j], batch.y[j], covar2, batch.dem[j]) >= iou_threshold)
+                    return true;
+            }
+            return false;
+#endif
+        }
+
+        /*
+         * Greedy rotated NMS over score sorted boxes. A candidate is only tested
+         * against boxes already kept. Kept boxes whose axis-aligned bounds can't
+         * touch the candidate are skipped before probiou: box i is bounded by
+         * its center +- e_i, e_i = sqrt(k * (w^2 + h^2)), k = (bd_thr + 0.25) / 3
+         * where probiou suppresses below the distance bd_thr = -ln((1 - t)^2).
+         * Disjoint bounds give a Mahalanobis term above bd_thr + 0.25, which
+         * leaves margin for the log / exp approximations. The remaining kept
+         * boxes are scored four at a time.
+         */
         static inline void nms_rotated_sorted_bboxes(
-            const std::vector<Object>& objects, 
+            const std::vector<Object>& objects,
             std::vector<int>& picked,
             float nms_threshold)
         {
+            picked.clear();
+            const int n = objects.size();
             std::vector<cv::Point3f> covar_maxtrix;
+            covar_maxtrix.reserve(n);
             get_covariance_matrix(objects, covar_maxtrix);
-            
-            float nms_threshold_ = (1.f - nms_threshold) * (1.f - nms_threshold);
-            int n = objects.size();
-            
-            for (size_t i = 0; i < n; ++i) {
-                float max_iou = 0.f;
-                const Object& obj1 = objects[i];
-
-                for (size_t j = 0; j < i; ++j) {
-                    const Object& obj2 = objects[j];
-                    
-                    float iou = probiou(obj1, obj2, covar_maxtrix[i], covar_maxtrix[j]);
-                    if (iou > max_iou){
-                        max_iou = iou;
-                    }
-                    
+
+            const float iou_threshold = (1.f - nms_threshold) * (1.f - nms_threshold);
+            const float bd_threshold = -std::log(iou_threshold);
+            const bool prefilter = std::isfinite(bd_threshold);
+            const float k = std::max((bd_threshold + 0.25f) / 3.f, 0.f);
+
+            std::vector<float> dem(n), extent(n);
+            for (int i = 0; i < n; i++)
+            {
+                const cv::Point3f& s = covar_maxtrix[i];
+                dem[i] = clamp_(s.x * s.y - s.z * s.z);
+                const float w = objects[i].rect.width, h = objects[i].rect.height;
+                extent[i] = prefilter ? std::sqrt(k * (w * w + h * h)) : 0.f;
+            }
+
+            ProbiouBatch batch;
+            for (int i = 0; i < n; i++)
+            {
+                const float xi = objects[i].rect.x, yi = objects[i].rect.y;
+                batch.clear();
+                for (int j : picked)
+                {
+                    const float reach = extent[i] + extent[j];
+                    if (prefilter && (std::fabs(xi - objects[j].rect.x) > reach || std::fabs(yi - objects[j].rect.y) > reach))
+                        continue;
+                    batch.push(objects[j].rect.x, objects[j].rect.y, covar_maxtrix[j], dem[j]);
                 }
-                if (max_iou < nms_threshold_)
+
+                if (batch.count == 0 || !probiou_batch_any(xi, yi, covar_maxtrix[i], dem[i], batch, iou_threshold))
                     picked.push_back(i);
             }
         }
@@ -2923,26 +3221,7 @@ namespace detection
             std::vector<int> picked;
             obb::nms_rotated_sorted_bboxes(proposals, picked, nms_threshold);
             
-            /* yolov5 draw the result */
-            float scale_letterbox;
-            int resize_rows;
-            int resize_cols;
-            if ((letterbox_rows * 1.0 / src_rows) < (letterbox_cols * 1.0 / src_cols))
-            {
-                scale_letterbox = letterbox_rows * 1.0 / src_rows;
-            }
-            else
-            {
-                scale_letterbox = letterbox_cols * 1.0 / src_cols;
-            }
-            resize_cols = int(scale_letterbox * src_cols);
-            resize_rows = int(scale_letterbox * src_rows);
-
-            int tmp_h = (letterbox_rows - resize_rows) / 2;
-            int tmp_w = (letterbox_cols - resize_cols) / 2;
-
-            float ratio_x = (float)src_rows / resize_rows;
-            float ratio_y = (float)src_cols / resize_cols;
+            const LetterboxTransform lb(letterbox_rows, letterbox_cols, src_rows, src_cols);
 
             int count = picked.size();
             double pi = M_PI;
@@ -2955,10 +3234,10 @@ namespace detection
                 float h_ = objects[i].rect.width > objects[i].rect.height ? objects[i].rect.height : objects[i].rect.width;
                 float a_ = (float)std::fmod((objects[i].rect.width > objects[i].rect.height ? objects[i].angle : objects[i].angle + pi_2), pi);
 
-                float xc = (objects[i].rect.x - tmp_w) * ratio_x;
-                float yc = (objects[i].rect.y - tmp_h) * ratio_y;
-                float w = w_ * ratio_x;
-                float h = h_ * ratio_y;
+                float xc = lb.map_x(objects[i].rect.x);
+                float yc = lb.map_y(objects[i].rect.y);
+                float w = w_ * lb.ratio_x;
+                float h = h_ * lb.ratio_y;
 
                 // clip
                 xc = std::max(std::min(xc, (float)(src_cols - 1)), 0.f);
@@ -2974,42 +3253,29 @@ namespace detection
                 objects[i].angle = a_;
             }
         }
-        static void generate_proposals_yolov8_obb_native(const std::vector<GridAndStride>& grid_strides, const float* feat, float prob_threshold, std::vector<Object>& objects,
-                                                 int letterbox_cols, int letterbox_rows, int cls_num = 15)
+        static void generate_proposals_yolov8_obb_native(const GridSpan& grid_strides, const float* feat, float prob_threshold, std::vector<Object>& objects,
+                                                         int letterbox_cols, int letterbox_rows, int cls_num = 15)
         {
-            const int num_points = grid_strides.size();
+            const int num_points = grid_strides.size;
             int reg_max = 16;
+            const float prob_threshold_unsigmoid = unsigmoid(prob_threshold);
             auto feat_ptr = feat;
-            std::vector<float> dis_after_sm(reg_max, 0.f);
             for (int i = 0; i < num_points; i++)
             {
                 // process cls score
-                int class_index = 0;
-                float class_score = -FLT_MAX;
-                for (int s = 0; s < cls_num; s++)
-                {
-                    float score = feat_ptr[s + 4 * reg_max];
-                    if (score > class_score)
-                    {
-                        class_index = s;
-                        class_score = score;
-                    }
-                }
+                float class_score;
+                int class_index = simd::argmax(feat_ptr + 4 * reg_max, cls_num, &class_score);
 
-                float box_prob = sigmoid(class_score);
+                float box_prob = class_score < prob_threshold_unsigmoid ? 0.f : sigmoid(class_score);
                 if (box_prob > prob_threshold)
                 {
                     float pred_ltrb[4];
-                    for (int k = 0; k < 4; k++)
-                    {
-                        float dis = softmax(feat_ptr + k * reg_max, dis_after_sm.data(), reg_max);
-                        pred_ltrb[k] = dis * grid_strides[i].stride;
-                    }
+                    simd::dfl_decode(feat_ptr, reg_max, grid_strides.stride[i], pred_ltrb);
 
                     float angle = feat_ptr[4 * reg_max + cls_num];
 
-                    float pb_cx = (grid_strides[i].grid0 + 0.5f) * grid_strides[i].stride;
-                    float pb_cy = (grid_strides[i].grid1 + 0.5f) * grid_strides[i].stride;
+                    float pb_cx = grid_strides.center_x[i];
+                    float pb_cy = grid_strides.center_y[i];
 
                     float cos = std::cos(angle);
                     float sin = std::sin(angle);
@@ -3035,6 +3301,25 @@ namespace detection
                 feat_ptr += (cls_num + 4 * reg_max + 1);
             }
         }
+
+        static void generate_proposals_yolov8_obb_native(const std::vector<GridAndStride>& grid_strides, const float* feat, float prob_threshold, std::vector<Object>& objects,
+                                                         int letterbox_cols, int letterbox_rows, int cls_num = 15)
+        {
+            std::vector<float> center_x, center_y, stride;
+            for (const GridAndStride& gs : grid_strides)
+            {
+                center_x.push_back((gs.grid0 + 0.5f) * gs.stride);
+                center_y.push_back((gs.grid1 + 0.5f) * gs.stride);
+                stride.push_back((float)gs.stride);
+            }
+            GridSpan span;
+            span.grids = grid_strides.data();
+            span.center_x = center_x.data();
+            span.center_y = center_y.data();
+            span.stride = stride.data();
+            span.size = (int)grid_strides.size();
+            generate_proposals_yolov8_obb_native(span, feat, prob_threshold, objects, letterbox_cols, letterbox_rows, cls_num);
+        }
         static void draw_objects_obb(const cv::Mat& bgr, const std::vector<Object>& objects, const char** class_names, const char* output_name, int thickness = 1)
         {
             static const std::vector<cv::Scalar> COCO_COLORS = {
@@ -3121,6 +3406,55 @@ namespace detection
     }
 
 
+    /*
+     * YOLOv10 one-to-one head without NMS: the top.k() best cells over all
+     * levels scoring at least prob_threshold, best first. feats[i] is the
+     * output of strides[i], a cell is cls_num scores then 4 x 16 DFL bins, and
+     * only the winners have their boxes decoded.
+     */
+    static void generate_topk_yolov10(const std::vector<const float*>& feats, const std::vector<int>& strides, float prob_threshold, query::TopK& top, std::vector<Object>& objects,
+                                      int letterbox_cols, int letterbox_rows, int cls_num = 80)
+    {
+        const int cell = cls_num + 4 * 16;
+        top.clear(std::nextafter(prob_threshold, -FLT_MAX));
+        std::vector<uint32_t> first(feats.size() + 1, 0);
+        for (size_t i = 0; i < feats.size(); i++)
+        {
+            const int cells = (letterbox_cols / strides[i]) * (letterbox_rows / strides[i]);
+            query::select_best(feats[i], cells, cls_num, cell, top, first[i]);
+            first[i + 1] = first[i] + cells;
+        }
+
+        float dis[16];
+        for (const auto& c : top.sorted())
+        {
+            size_t level = 0;
+            while (c.query >= first[level + 1])
+                level++;
+            const int stride = strides[level];
+            const int feat_w = letterbox_cols / stride;
+            const int index = (int)(c.query - first[level]);
+            const int w = index % feat_w;
+            const int h = index / feat_w;
+            const float* box = feats[level] + (size_t)index * cell + cls_num;
+
+            const float x0 = (w + 0.5f - mmyolo::fast_softmax(box + 0 * 16, dis, 16)) * stride;
+            const float y0 = (h + 0.5f - mmyolo::fast_softmax(box + 1 * 16, dis, 16)) * stride;
+            const float x1 = (w + 0.5f + mmyolo::fast_softmax(box + 2 * 16, dis, 16)) * stride;
+            const float y1 = (h + 0.5f + mmyolo::fast_softmax(box + 3 * 16, dis, 16)) * stride;
+
+            Object obj;
+            obj.rect.x = x0;
+            obj.rect.y = y0;
+            obj.rect.width = x1 - x0;
+            obj.rect.height = y1 - y0;
+            obj.label = c.label;
+            obj.prob = c.score;
+            objects.push_back(obj);
+        }
+    }
+
+
 //Added a function that does not have imwrite.
 //20241219 @nnn112358
 
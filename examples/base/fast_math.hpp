@@ -0,0 +1,493 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include "base/simd.hpp"
+
+/*
+ * Elementary functions for post-processing in four precision levels. Each
+ * variant is also callable directly (exp_poly, sigmoid_lut, ...); the plain
+ * names dispatch on the process wide precision, which starts at
+ * AX_SAMPLES_FAST_MATH_PRECISION (exact unless the build says otherwise) and
+ * can be changed with set_precision().
+ *
+ * Measured worst case error against double precision over the usable range:
+ *
+ *              exp (relative)    sigmoid (absolute)   log (absolute, relative above 1)
+ *   EXACT      6e-8              3e-8                 6e-8
+ *   POLY       8e-8              9e-8                 8e-8
+ *   LUT        1.7e-7            1.2e-5               2e-6
+ *   BITHACK    -4.5% / +1.5%     1.2e-2               7e-3
+ *
+ * exp is valid on [-87.3, 88.3] (inputs are clamped there except in EXACT),
+ * log on positive normal floats. The batch forms of POLY use simd::exp and a
+ * vector log and give the same results as the scalar calls.
+ */
+#ifndef AX_SAMPLES_FAST_MATH_PRECISION
+#define AX_SAMPLES_FAST_MATH_PRECISION 0
+#endif
+
+namespace fast_math
+{
+    enum Precision
+    {
+        PRECISION_EXACT = 0,   /* libm */
+        PRECISION_POLY = 1,    /* range reduction + polynomial, vectorized in the batch forms */
+        PRECISION_LUT = 2,     /* table + interpolation */
+        PRECISION_BITHACK = 3, /* IEEE-754 exponent tricks, coarsest and cheapest */
+    };
+
+    /* not static, so all translation units share the one setting */
+    inline int& precision_storage()
+    {
+        static int value = AX_SAMPLES_FAST_MATH_PRECISION;
+        return value;
+    }
+
+    static inline Precision precision()
+    {
+        return (Precision)precision_storage();
+    }
+
+    static inline void set_precision(Precision p)
+    {
+        precision_storage() = (int)p;
+    }
+
+    static inline float from_bits(int32_t i)
+    {
+        float f;
+        memcpy(&f, &i, sizeof(f));
+        return f;
+    }
+
+    static inline int32_t to_bits(float f)
+    {
+        int32_t i;
+        memcpy(&i, &f, sizeof(i));
+        return i;
+    }
+
+    /* ---------------------------------------------------------------- exp */
+
+    /* the float overload of std::exp, as the decoders called it before */
+    static inline float exp_exact(float x)
+    {
+        return std::exp(x);
+    }
+
+    /* cephes expf, scalar twin of simd::exp */
+    static inline float exp_poly(float x)
+    {
+        x = std::min(x, 88.3762626647949f);
+        x = std::max(x, -88.3762626647949f);
+
+        float fx = std::floor(x * 1.44269504088896341f + 0.5f);
+        x = x - fx * 0.693359375f;
+        x = x - fx * -2.12194440e-4f;
+        float z = x * x;
+
+        float y = 1.9875691500E-4f;
+        y = y * x + 1.3981999507E-3f;
+        y = y * x + 8.3334519073E-3f;
+        y = y * x + 4.1665795894E-2f;
+        y = y * x + 1.6666665459E-1f;
+        y = y * x + 5.0000001201E-1f;
+        y = y * z + x;
+        y = y + 1.f;
+
+        return y * from_bits(((int32_t)fx + 127) << 23);
+    }
+
+    /* 2^(k / 64), k = 0..63 */
+    static inline const float* exp2_table()
+    {
+        static float table[64];
+        static bool ready = [] {
+            for (int k = 0; k < 64; k++)
+            {
+                table[k] = (float)std::pow(2.0, k / 64.0);
+            }
+            return true;
+        }();
+        (void)ready;
+        return table;
+    }
+
+    /* x = (64 n + k) ln2 / 64 + r, |r| <= ln2 / 128: 2^n * table[k] * (1 + r + r^2 / 2 + r^3 / 6) */
+    static inline float exp_lut(float x)
+    {
+        x = std::min(x, 88.3762626647949f);
+        x = std::max(x, -87.3365478515625f);
+
+        float t = std::floor(x * 92.332482616893657f + 0.5f); /* 64 / ln2 */
+        int32_t n = (int32_t)t;
+        float r = x - t * 0.010833740234375f - t * -3.31553813e-6f; /* ln2 / 64 split in two */
+        float p = 1.f + r * (1.f + r * (0.5f + r * 0.166666667f));
+        int32_t k = n & 63;
+        int32_t e = n >> 6;
+        return exp2_table()[k] * p * from_bits((e + 127) << 23);
+    }
+
+    /* Schraudolph's exponent trick, same constants as the former mmyolo / obb fast_exp */
+    static inline float exp_bithack(float x)
+    {
+        double v = (1 << 23) * (1.4426950409 * x + 126.93490512f);
+        v = std::max(std::min(v, 2139095039.0), 0.0);
+        uint32_t i = (uint32_t)v;
+        float f;
+        memcpy(&f, &i, sizeof(f));
+        return f;
+    }
+
+    static inline float exp(float x, Precision p)
+    {
+        switch (p)
+        {
+        case PRECISION_POLY:
+            return exp_poly(x);
+        case PRECISION_LUT:
+            return exp_lut(x);
+        case PRECISION_BITHACK:
+            return exp_bithack(x);
+        default:
+            return exp_exact(x);
+        }
+    }
+
+    static inline float exp(float x)
+    {
+        return exp(x, precision());
+    }
+
+    /* ------------------------------------------------------------ sigmoid */
+
+    static inline float sigmoid_exact(float x)
+    {
+        return 1.f / (1.f + std::exp(-x));
+    }
+
+    static inline float sigmoid_poly(float x)
+    {
+        return 1.f / (1.f + exp_poly(-x));
+    }
+
+    /* sigmoid on [-16, 16] in steps of 1 / 32 */
+    static inline const float* sigmoid_table()
+    {
+        static float table[1025];
+        static bool ready = [] {
+            for (int i = 0; i < 1025; i++)
+            {
+                table[i] = (float)(1.0 / (1.0 + std::exp(-(i / 32.0 - 16.0))));
+            }
+            return true;
+        }();
+        (void)ready;
+        return table;
+    }
+
+    /* linear interpolation, saturates to 0 / 1 outside the table */
+    static inline float sigmoid_lut(float x)
+    {
+        if (!(x > -16.f))
+            return 0.f;
+        if (x >= 16.f)
+            return 1.f;
+        float t = (x + 16.f) * 32.f;
+        int i = std::min((int)t, 1023);
+        float f = t - (float)i;
+        const float* table = sigmoid_table();
+        return table[i] + (table[i + 1] - table[i]) * f;
+    }
+
+    static inline float sigmoid_bithack(float x)
+    {
+        return 1.0f / (1.0f + exp_bithack(-x));
+    }
+
+    static inline float sigmoid(float x, Precision p)
+    {
+        switch (p)
+        {
+        case PRECISION_POLY:
+            return sigmoid_poly(x);
+        case PRECISION_LUT:
+            return sigmoid_lut(x);
+        case PRECISION_BITHACK:
+            return sigmoid_bithack(x);
+        default:
+            return sigmoid_exact(x);
+        }
+    }
+
+    static inline float sigmoid(float x)
+    {
+        return sigmoid(x, precision());
+    }
+
+    /* ---------------------------------------------------------------- log */
+
+    static inline float log_exact(float x)
+    {
+        return std::log(x);
+    }
+
+    /* cephes logf */
+    static inline float log_poly(float x)
+    {
+        int32_t bits = to_bits(x);
+        float e = (float)(((bits >> 23) & 0xff) - 126);
+        float m = from_bits((bits & 0x807fffff) + (126 << 23)); /* [0.5, 1) */
+        if (m < 0.707106781186547524f)
+        {
+            e -= 1.f;
+            m = m + m - 1.f;
+        }
+        else
+        {
+            m = m - 1.f;
+        }
+
+        float z = m * m;
+        float y = 7.0376836292E-2f;
+        y = y * m - 1.1514610310E-1f;
+        y = y * m + 1.1676998740E-1f;
+        y = y * m - 1.2420140846E-1f;
+        y = y * m + 1.4249322787E-1f;
+        y = y * m - 1.6668057665E-1f;
+        y = y * m + 2.0000714765E-1f;
+        y = y * m - 2.4999993993E-1f;
+        y = y * m + 3.3333331174E-1f;
+        y = y * m * z;
+        y = y + e * -2.12194440e-4f;
+        y = y - 0.5f * z;
+        return m + y + e * 0.693359375f;
+    }
+
+    /* log2(1 + k / 256), k = 0..256 */
+    static inline const float* log2_table()
+    {
+        static float table[257];
+        static bool ready = [] {
+            for (int k = 0; k < 257; k++)
+            {
+                table[k] = (float)std::log2(1.0 + k / 256.0);
+            }
+            return true;
+        }();
+        (void)ready;
+        return table;
+    }
+
+    /* exponent plus the interpolated mantissa log */
+    static inline float log_lut(float x)
+    {
+        int32_t bits = to_bits(x);
+        int32_t e = ((bits >> 23) & 0xff) - 127;
+        int32_t mant = bits & 0x7fffff;
+        int32_t k = mant >> 15;
+        float f = (float)(mant & 0x7fff) * (1.f / 32768.f);
+        const float* table = log2_table();
+        return ((float)e + table[k] + (table[k + 1] - table[k]) * f) * 0.69314718f;
+    }
+
+    /* quadratic mantissa fit, same as the former obb fast_log2 */
+    static inline float log2_bithack(float x)
+    {
+        int32_t m = to_bits(x);
+        const int log_2 = ((m >> 23) & 255) - 128;
+        m &= ~(255 << 23);
+        m += 127 << 23;
+        float v = from_bits(m);
+        return (((-1.f / 3) * v + 2) * v - 2.f / 3 + log_2);
+    }
+
+    static inline float log_bithack(float x)
+    {
+        return 0.69314718f * log2_bithack(x);
+    }
+
+    static inline float log(float x, Precision p)
+    {
+        switch (p)
+        {
+        case PRECISION_POLY:
+            return log_poly(x);
+        case PRECISION_LUT:
+            return log_lut(x);
+        case PRECISION_BITHACK:
+            return log_bithack(x);
+        default:
+            return log_exact(x);
+        }
+    }
+
+    static inline float log(float x)
+    {
+        return log(x, precision());
+    }
+
+    /* ------------------------------------------------------- batch forms */
+
+#if defined(AX_SAMPLES_SIMD)
+    /* vector twin of log_poly */
+    static inline simd::v4f log_poly(simd::v4f x)
+    {
+        simd::v4i bits = simd::as_int(x);
+        simd::v4f e = simd::to_float(simd::sub_int(simd::and_int(simd::shift_right<23>(bits), simd::set1_int(0xff)), simd::set1_int(126)));
+        simd::v4f m = simd::as_float(simd::add_int(simd::and_int(bits, simd::set1_int((int32_t)0x807fffff)), simd::set1_int(126 << 23)));
+
+        const simd::v4f sqrthf = simd::set1(0.707106781186547524f);
+        e = simd::select_gt(sqrthf, m, simd::sub(e, simd::set1(1.f)), e);
+        m = simd::select_gt(sqrthf, m, simd::sub(simd::add(m, m), simd::set1(1.f)), simd::sub(m, simd::set1(1.f)));
+
+        simd::v4f z = simd::mul(m, m);
+        simd::v4f y = simd::set1(7.0376836292E-2f);
+        y = simd::fmadd(y, m, simd::set1(-1.1514610310E-1f));
+        y = simd::fmadd(y, m, simd::set1(1.1676998740E-1f));
+        y = simd::fmadd(y, m, simd::set1(-1.2420140846E-1f));
+        y = simd::fmadd(y, m, simd::set1(1.4249322787E-1f));
+        y = simd::fmadd(y, m, simd::set1(-1.6668057665E-1f));
+        y = simd::fmadd(y, m, simd::set1(2.0000714765E-1f));
+        y = simd::fmadd(y, m, simd::set1(-2.4999993993E-1f));
+        y = simd::fmadd(y, m, simd::set1(3.3333331174E-1f));
+        y = simd::mul(simd::mul(y, m), z);
+        y = simd::fmadd(e, simd::set1(-2.12194440e-4f), y);
+        y = simd::sub(y, simd::mul(simd::set1(0.5f), z));
+        return simd::fmadd(e, simd::set1(0.693359375f), simd::add(m, y));
+    }
+#endif
+
+    /* dst[i] = exp(src[i]), in place is fine */
+    static inline void exp(const float* src, float* dst, int n, Precision p)
+    {
+        int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        if (p == PRECISION_POLY)
+        {
+            for (; i + 4 <= n; i += 4)
+            {
+                simd::store(dst + i, simd::exp(simd::load(src + i)));
+            }
+        }
+#endif
+        for (; i < n; i++)
+        {
+            dst[i] = exp(src[i], p);
+        }
+    }
+
+    static inline void sigmoid(const float* src, float* dst, int n, Precision p)
+    {
+        int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        if (p == PRECISION_POLY)
+        {
+            const simd::v4f one = simd::set1(1.f);
+            for (; i + 4 <= n; i += 4)
+            {
+                simd::v4f e = simd::exp(simd::sub(simd::set1(0.f), simd::load(src + i)));
+                simd::store(dst + i, simd::div(one, simd::add(one, e)));
+            }
+        }
+#endif
+        for (; i < n; i++)
+        {
+            dst[i] = sigmoid(src[i], p);
+        }
+    }
+
+    static inline void log(const float* src, float* dst, int n, Precision p)
+    {
+        int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        if (p == PRECISION_POLY)
+        {
+            for (; i + 4 <= n; i += 4)
+            {
+                simd::store(dst + i, log_poly(simd::load(src + i)));
+            }
+        }
+#endif
+        for (; i < n; i++)
+        {
+            dst[i] = log(src[i], p);
+        }
+    }
+
+    /* normalized exp(src - max) into dst */
+    static inline void softmax(const float* src, float* dst, int n, Precision p)
+    {
+        const float alpha = *std::max_element(src, src + n);
+        float denominator = 0.f;
+        int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        if (p == PRECISION_POLY)
+        {
+            const simd::v4f a = simd::set1(alpha);
+            simd::v4f sum = simd::set1(0.f);
+            for (; i + 4 <= n; i += 4)
+            {
+                simd::v4f e = simd::exp(simd::sub(simd::load(src + i), a));
+                simd::store(dst + i, e);
+                sum = simd::add(sum, e);
+            }
+            denominator = simd::reduce_add(sum);
+        }
+#endif
+        for (; i < n; i++)
+        {
+            dst[i] = exp(src[i] - alpha, p);
+            denominator += dst[i];
+        }
+        for (i = 0; i < n; i++)
+        {
+            dst[i] /= denominator;
+        }
+    }
+
+    static inline void exp(const float* src, float* dst, int n)
+    {
+        exp(src, dst, n, precision());
+    }
+
+    static inline void sigmoid(const float* src, float* dst, int n)
+    {
+        sigmoid(src, dst, n, precision());
+    }
+
+    static inline void log(const float* src, float* dst, int n)
+    {
+        log(src, dst, n, precision());
+    }
+
+    static inline void softmax(const float* src, float* dst, int n)
+    {
+        softmax(src, dst, n, precision());
+    }
+} // namespace fast_math
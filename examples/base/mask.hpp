@@ -0,0 +1,327 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+/*
+ * Compact instance masks. BitMask keeps one bit per pixel of the object box,
+ * RLE is the COCO run-length format over the whole image (column major, runs
+ * alternate starting with background) and converts to / from the compressed
+ * string used by pycocotools, so results can go to COCO evaluation as is.
+ */
+namespace mask
+{
+    typedef struct BitMask
+    {
+        /* box in image coordinates */
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+        /* rows of (width + 7) / 8 bytes, bit c % 8 of byte c / 8 is column c */
+        std::vector<uint8_t> bits;
+
+        int row_bytes() const
+        {
+            return (width + 7) / 8;
+        }
+
+        bool at(int r, int c) const
+        {
+            return (bits[(size_t)r * row_bytes() + (c >> 3)] >> (c & 7)) & 1;
+        }
+    } BitMask;
+
+    typedef struct RLE
+    {
+        int height = 0;
+        int width = 0;
+        std::vector<uint32_t> counts;
+    } RLE;
+
+    /* packs logits > 0 (i.e. sigmoid > 0.5) of a CV_32FC1 map placed at (x, y) */
+    static void encode_bitmask(const cv::Mat& logits, int x, int y, BitMask& out)
+    {
+        out.x = x;
+        out.y = y;
+        out.width = logits.cols;
+        out.height = logits.rows;
+        const int row_bytes = out.row_bytes();
+        out.bits.assign((size_t)row_bytes * out.height, 0);
+
+        for (int r = 0; r < out.height; r++)
+        {
+            const float* src = logits.ptr<float>(r);
+            uint8_t* dst = out.bits.data() + (size_t)r * row_bytes;
+            int c = 0;
+            for (; c + 8 <= out.width; c += 8)
+            {
+                dst[c >> 3] = (uint8_t)((src[c] > 0.f) | (src[c + 1] > 0.f) << 1 | (src[c + 2] > 0.f) << 2 | (src[c + 3] > 0.f) << 3
+                                        | (src[c + 4] > 0.f) << 4 | (src[c + 5] > 0.f) << 5 | (src[c + 6] > 0.f) << 6 | (src[c + 7] > 0.f) << 7);
+            }
+            for (; c < out.width; c++)
+            {
+                dst[c >> 3] |= (uint8_t)((src[c] > 0.f) << (c & 7));
+            }
+        }
+    }
+
+    /* all background box of w x h at (x, y) */
+    static void clear_bitmask(int x, int y, int width, int height, BitMask& out)
+    {
+        out.x = x;
+        out.y = y;
+        out.width = std::max(width, 0);
+        out.height = std::max(height, 0);
+        out.bits.assign((size_t)out.row_bytes() * out.height, 0);
+    }
+
+    /* same for a CV_8UC1 binary mask (non zero is foreground) */
+    static void encode_bitmask_u8(const cv::Mat& binary, int x, int y, BitMask& out)
+    {
+        out.x = x;
+        out.y = y;
+        out.width = binary.cols;
+        out.height = binary.rows;
+        const int row_bytes = out.row_bytes();
+        out.bits.assign((size_t)row_bytes * out.height, 0);
+
+        for (int r = 0; r < out.height; r++)
+        {
+            const uint8_t* src = binary.ptr<uint8_t>(r);
+            uint8_t* dst = out.bits.data() + (size_t)r * row_bytes;
+            for (int c = 0; c < out.width; c++)
+            {
+                dst[c >> 3] |= (uint8_t)((src[c] != 0) << (c & 7));
+            }
+        }
+    }
+
+    /* CV_8UC1 mask of the box, 255 for foreground like `logits > 0` */
+    static cv::Mat decode_bitmask(const BitMask& m)
+    {
+        cv::Mat out(m.height, m.width, CV_8UC1);
+        for (int r = 0; r < m.height; r++)
+        {
+            uint8_t* dst = out.ptr<uint8_t>(r);
+            for (int c = 0; c < m.width; c++)
+            {
+                dst[c] = m.at(r, c) ? 255 : 0;
+            }
+        }
+        return out;
+    }
+
+    /* COCO RLE of a packed box mask inside an image of img_h x img_w, the box is clipped */
+    static void encode_rle(const BitMask& m, int img_h, int img_w, RLE& out)
+    {
+        out.height = img_h;
+        out.width = img_w;
+        out.counts.clear();
+
+        const int x0 = std::max(m.x, 0), x1 = std::min(m.x + m.width, img_w);
+        const int y0 = std::max(m.y, 0), y1 = std::min(m.y + m.height, img_h);
+
+        /* runs alternate background / foreground, starting with background */
+        uint32_t run = 0;
+        bool value = false;
+        auto push = [&](bool v, uint32_t n) {
+            if (n == 0)
+                return;
+            if (v != value)
+            {
+                out.counts.push_back(run);
+                run = 0;
+                value = v;
+            }
+            run += n;
+        };
+
+        for (int c = 0; c < img_w; c++)
+        {
+            if (c < x0 || c >= x1 || y0 >= y1)
+            {
+                push(false, img_h);
+                continue;
+            }
+            push(false, y0);
+            int mc = c - m.x;
+            for (int r = y0; r < y1; r++)
+            {
+                push(m.at(r - m.y, mc), 1);
+            }
+            push(false, img_h - y1);
+        }
+        out.counts.push_back(run);
+    }
+
+    /* straight from a CV_32FC1 logit map placed at (x, y) */
+    static void encode_rle(const cv::Mat& logits, int x, int y, int img_h, int img_w, RLE& out)
+    {
+        BitMask m;
+        encode_bitmask(logits, x, y, m);
+        encode_rle(m, img_h, img_w, out);
+    }
+
+    /* full image CV_8UC1 mask, 255 for foreground; runs past height * width are dropped */
+    static cv::Mat decode_rle(const RLE& rle)
+    {
+        cv::Mat out = cv::Mat::zeros(rle.height, rle.width, CV_8UC1);
+        const size_t total = (size_t)std::max(rle.height, 0) * std::max(rle.width, 0);
+        size_t pos = 0;
+        bool value = false;
+        for (uint32_t n : rle.counts)
+        {
+            if (pos >= total)
+                break;
+            if (value)
+            {
+                const size_t end = std::min(pos + n, total);
+                for (size_t p = pos; p < end; p++)
+                {
+                    out.at<uint8_t>((int)(p % rle.height), (int)(p / rle.height)) = 255;
+                }
+            }
+            pos += n;
+            value = !value;
+        }
+        return out;
+    }
+
+    /* pycocotools rleToString: LEB128-like 5 bit groups, counts after the second are delta coded */
+    static std::string rle_to_string(const RLE& rle)
+    {
+        std::string s;
+        for (size_t i = 0; i < rle.counts.size(); i++)
+        {
+            long x = (long)rle.counts[i];
+            if (i > 2)
+                x -= (long)rle.counts[i - 2];
+            bool more = true;
+            while (more)
+            {
+                char c = (char)(x & 0x1f);
+                x >>= 5;
+                more = (c & 0x10) ? x != -1 : x != 0;
+                if (more)
+                    c |= 0x20;
+                s.push_back((char)(c + 48));
+            }
+        }
+        return s;
+    }
+
+    /* pycocotools rleFrString */
+    static void rle_from_string(const std::string& s, int height, int width, RLE& out)
+    {
+        out.height = height;
+        out.width = width;
+        out.counts.clear();
+        size_t p = 0;
+        while (p < s.size())
+        {
+            long x = 0;
+            int k = 0;
+            bool more = true;
+            while (more && p < s.size())
+            {
+                long c = (long)s[p] - 48;
+                x |= (c & 0x1f) << (5 * k);
+                more = (c & 0x20) != 0;
+                p++;
+                k++;
+                if (!more && (c & 0x10))
+                    x |= (long)(~0UL << (5 * k));
+            }
+            if (out.counts.size() > 2)
+                x += (long)out.counts[out.counts.size() - 2];
+            out.counts.push_back((uint32_t)x);
+        }
+    }
+
+    /* foreground area in pixels */
+    static uint64_t area(const RLE& rle)
+    {
+        uint64_t a = 0;
+        for (size_t i = 1; i < rle.counts.size(); i += 2)
+        {
+            a += rle.counts[i];
+        }
+        return a;
+    }
+
+    static inline void blend_pixel(uint8_t* p, const uint8_t* color, int alpha_256)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            p[k] = (uint8_t)((p[k] * (256 - alpha_256) + color[k] * alpha_256) >> 8);
+        }
+    }
+
+    /* blends color into the foreground of a CV_8UC3 image, alpha in [0, 1] */
+    static void draw_bitmask(cv::Mat& bgr, const BitMask& m, const cv::Scalar& color, float alpha = 0.5f)
+    {
+        const uint8_t c[3] = {(uint8_t)color[0], (uint8_t)color[1], (uint8_t)color[2]};
+        const int a = (int)(alpha * 256.f);
+        const int r0 = std::max(0, -m.y), r1 = std::min(m.height, bgr.rows - m.y);
+        const int c0 = std::max(0, -m.x), c1 = std::min(m.width, bgr.cols - m.x);
+        for (int r = r0; r < r1; r++)
+        {
+            uint8_t* row = bgr.ptr<uint8_t>(m.y + r);
+            const uint8_t* bits = m.bits.data() + (size_t)r * m.row_bytes();
+            for (int cc = c0; cc < c1; cc++)
+            {
+                if ((bits[cc >> 3] >> (cc & 7)) & 1)
+                    blend_pixel(row + (m.x + cc) * 3, c, a);
+            }
+        }
+    }
+
+    /* same from an RLE, only the foreground runs are visited */
+    static void draw_rle(cv::Mat& bgr, const RLE& rle, const cv::Scalar& color, float alpha = 0.5f)
+    {
+        const uint8_t c[3] = {(uint8_t)color[0], (uint8_t)color[1], (uint8_t)color[2]};
+        const int a = (int)(alpha * 256.f);
+        const int rows = std::min(rle.height, bgr.rows);
+        const int cols = std::min(rle.width, bgr.cols);
+        size_t pos = 0;
+        for (size_t i = 0; i < rle.counts.size(); i++)
+        {
+            size_t end = pos + rle.counts[i];
+            if (i & 1)
+            {
+                for (size_t p = pos; p < end; p++)
+                {
+                    int r = (int)(p % rle.height);
+                    int col = (int)(p / rle.height);
+                    if (r < rows && col < cols)
+                        blend_pixel(bgr.ptr<uint8_t>(r) + col * 3, c, a);
+                }
+            }
+            pos = end;
+        }
+    }
+} // namespace mask
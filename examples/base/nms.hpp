@@ -0,0 +1,247 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace nms
+{
+    enum
+    {
+        NMS_EXHAUSTIVE = 0, /* every candidate against every kept box, O(n^2) */
+        NMS_GRID = 1,       /* candidates only meet kept boxes sharing a grid cell */
+    };
+
+    struct Box
+    {
+        float x0;
+        float y0;
+        float x1;
+        float y1;
+    };
+
+    /*
+     * Uniform grid over the candidate extent, the cell size follows the mean box
+     * size so a box usually lands in 1-4 cells. Kept boxes are chained per cell
+     * in one flat node array; boxes spanning too many cells go to a list that
+     * every query scans.
+     */
+    class GridIndex
+    {
+    public:
+        /* returns false when a box is empty-inverted or NaN, callers then fall back */
+        bool reset(const std::vector<Box>& boxes)
+        {
+            m_boxes = &boxes;
+            m_nodes.clear();
+            m_large.clear();
+
+            const int n = (int)boxes.size();
+            if (n == 0)
+                return true;
+
+            float min_x = boxes[0].x0, min_y = boxes[0].y0;
+            float max_x = boxes[0].x1, max_y = boxes[0].y1;
+            double sum_size = 0;
+            for (int i = 0; i < n; i++)
+            {
+                const Box& b = boxes[i];
+                if (!(b.x1 >= b.x0 && b.y1 >= b.y0))
+                    return false;
+                min_x = std::min(min_x, b.x0);
+                min_y = std::min(min_y, b.y0);
+                max_x = std::max(max_x, b.x1);
+                max_y = std::max(max_y, b.y1);
+                sum_size += std::max(b.x1 - b.x0, b.y1 - b.y0);
+            }
+
+            m_origin_x = min_x;
+            m_origin_y = min_y;
+            float cell = (float)(sum_size / n);
+            float span = std::max(max_x - min_x, max_y - min_y);
+            if (!(cell > 0.f) || !std::isfinite(span))
+                cell = std::max(span, 1.f);
+            /* at most ~256 x 256 cells */
+            cell = std::max(cell, span / 256.f);
+            m_inv_cell = 1.f / cell;
+            m_cols = cell_of(max_x, m_origin_x) + 1;
+            m_rows = cell_of(max_y, m_origin_y) + 1;
+
+            m_heads.assign((size_t)m_cols * m_rows, -1);
+            m_stamp.assign(n, -1);
+            return true;
+        }
+
+        void insert(int id)
+        {
+            const Box& b = (*m_boxes)[id];
+            int c0 = cell_of(b.x0, m_origin_x), c1 = cell_of(b.x1, m_origin_x);
+            int r0 = cell_of(b.y0, m_origin_y), r1 = cell_of(b.y1, m_origin_y);
+            if ((c1 - c0 + 1) * (r1 - r0 + 1) > 16)
+            {
+                m_large.push_back(id);
+                return;
+            }
+            for (int r = r0; r <= r1; r++)
+            {
+                for (int c = c0; c <= c1; c++)
+                {
+                    int* head = &m_heads[r * m_cols + c];
+                    m_nodes.push_back(Node{id, *head});
+                    *head = (int)m_nodes.size() - 1;
+                }
+            }
+        }
+
+        /* calls visit(j) once per kept box j that may overlap box id, stops on true */
+        template<typename Visitor>
+        bool query(int id, Visitor visit)
+        {
+            for (int j : m_large)
+            {
+                if (visit(j))
+                    return true;
+            }
+
+            const Box& b = (*m_boxes)[id];
+            int c0 = cell_of(b.x0, m_origin_x), c1 = cell_of(b.x1, m_origin_x);
+            int r0 = cell_of(b.y0, m_origin_y), r1 = cell_of(b.y1, m_origin_y);
+            for (int r = r0; r <= r1; r++)
+            {
+                for (int c = c0; c <= c1; c++)
+                {
+                    for (int node = m_heads[r * m_cols + c]; node >= 0; node = m_nodes[node].next)
+                    {
+                        int j = m_nodes[node].id;
+                        if (m_stamp[j] == id)
+                            continue;
+                        m_stamp[j] = id;
+                        if (visit(j))
+                            return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Node
+        {
+            int id;
+            int next;
+        };
+
+        /* monotonic in v, so boxes overlapping on an axis always share a cell index */
+        int cell_of(float v, float origin) const
+        {
+            int c = (int)((v - origin) * m_inv_cell);
+            return c < 0 ? 0 : c;
+        }
+
+        const std::vector<Box>* m_boxes = nullptr;
+        float m_origin_x = 0.f;
+        float m_origin_y = 0.f;
+        float m_inv_cell = 1.f;
+        int m_cols = 0;
+        int m_rows = 0;
+        std::vector<int> m_heads;
+        std::vector<Node> m_nodes;
+        std::vector<int> m_large;
+        std::vector<int> m_stamp;
+    };
+
+    /*
+     * Greedy NMS over score sorted boxes, suppress(i, j) tells whether kept box j
+     * removes candidate i. Only boxes sharing a cell are compared, so the picks
+     * equal the exhaustive loop for any criterion that never suppresses disjoint
+     * boxes (IoU with threshold >= 0). Returns false, leaving picked untouched,
+     * when the boxes can't be indexed.
+     */
+    template<typename Index, typename Suppress>
+    static bool greedy_grid(const std::vector<Box>& boxes, std::vector<Index>& picked, Suppress suppress)
+    {
+        GridIndex grid;
+        if (!grid.reset(boxes))
+            return false;
+
+        picked.clear();
+        const int n = (int)boxes.size();
+        for (int i = 0; i < n; i++)
+        {
+            bool suppressed = grid.query(i, [&](int j) { return suppress(i, j); });
+            if (!suppressed)
+            {
+                picked.push_back(i);
+                grid.insert(i);
+            }
+        }
+        return true;
+    }
+
+    /*
+     * IoU NMS over score sorted boxes, picked holds positions into boxes. With
+     * labels (one per box) only boxes of the same label suppress each other.
+     */
+    static void nms_sorted_boxes(const std::vector<Box>& boxes, std::vector<int>& picked, float nms_threshold, int nms_engine = NMS_EXHAUSTIVE,
+                                 const int* labels = nullptr)
+    {
+        picked.clear();
+
+        const int n = (int)boxes.size();
+        std::vector<float> areas(n);
+        for (int i = 0; i < n; i++)
+        {
+            areas[i] = (boxes[i].x1 - boxes[i].x0) * (boxes[i].y1 - boxes[i].y0);
+        }
+
+        auto suppress = [&](int i, int j) {
+            if (labels && labels[i] != labels[j])
+                return false;
+            float inter_w = std::min(boxes[i].x1, boxes[j].x1) - std::max(boxes[i].x0, boxes[j].x0);
+            float inter_h = std::min(boxes[i].y1, boxes[j].y1) - std::max(boxes[i].y0, boxes[j].y0);
+            if (inter_w <= 0.f || inter_h <= 0.f)
+                return false;
+            float inter_area = inter_w * inter_h;
+            float union_area = areas[i] + areas[j] - inter_area;
+            return inter_area / union_area > nms_threshold;
+        };
+
+        if (nms_engine == NMS_GRID && nms_threshold >= 0.f && greedy_grid(boxes, picked, suppress))
+            return;
+
+        for (int i = 0; i < n; i++)
+        {
+            bool keep = true;
+            for (int j : picked)
+            {
+                if (suppress(i, j))
+                {
+                    keep = false;
+                    break;
+                }
+            }
+            if (keep)
+                picked.push_back(i);
+        }
+    }
+} // namespace nms
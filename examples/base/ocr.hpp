@@ -0,0 +1,376 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "base/simd.hpp"
+#include "base/topk.hpp"
+
+/*
+ * Text line recognition with CTC heads (PP-OCR rec, CRNN). Line crops are
+ * grouped into width buckets so a batch is padded as little as possible, and
+ * the [batch, steps, classes] output is decoded per line over the steps that
+ * cover its real width, greedy or with a prefix beam search.
+ */
+namespace ocr
+{
+    struct TextLine
+    {
+        std::string text;
+        /* greedy: mean probability of the emitted characters, beam: per step geometric mean of the path probability */
+        float score;
+    };
+
+    /* one token per line */
+    static bool read_dict(const std::string& path, std::vector<std::string>& dict)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+        dict.clear();
+        std::string line;
+        while (std::getline(in, line))
+        {
+            dict.push_back(line);
+        }
+        return true;
+    }
+
+    /* model input width and batch size of one bucket */
+    struct Bucket
+    {
+        int width;
+        int batch;
+    };
+
+    /* a line crop in a batch, width is its width once resized to the model height */
+    struct LineSlot
+    {
+        int index;
+        int width;
+    };
+
+    struct Batch
+    {
+        int bucket;
+        std::vector<LineSlot> lines;
+    };
+
+    class WidthBuckets
+    {
+    public:
+        WidthBuckets(int height, std::vector<Bucket> buckets)
+            : height_(height), buckets_(std::move(buckets))
+        {
+            std::sort(buckets_.begin(), buckets_.end(), [](const Bucket& a, const Bucket& b) { return a.width < b.width; });
+        }
+
+        int height() const
+        {
+            return height_;
+        }
+
+        const Bucket& bucket(int index) const
+        {
+            return buckets_[index];
+        }
+
+        /*
+         * Lines sorted by width go to the narrowest bucket they fit in, lines
+         * wider than every bucket are squeezed into the widest. Neighbours in
+         * width share batches, so the padding of a batch stays small.
+         */
+        std::vector<Batch> plan(const std::vector<cv::Mat>& crops) const
+        {
+            std::vector<LineSlot> lines(crops.size());
+            for (size_t i = 0; i < crops.size(); i++)
+            {
+                const int w = (int)std::ceil((float)height_ * crops[i].cols / std::max(crops[i].rows, 1));
+                lines[i] = {(int)i, std::max(1, std::min(w, buckets_.back().width))};
+            }
+            std::stable_sort(lines.begin(), lines.end(), [](const LineSlot& a, const LineSlot& b) { return a.width < b.width; });
+
+            std::vector<Batch> batches;
+            size_t b = 0;
+            for (const auto& line : lines)
+            {
+                while (buckets_[b].width < line.width)
+                    b++;
+                if (batches.empty() || batches.back().bucket != (int)b || (int)batches.back().lines.size() == buckets_[b].batch)
+                    batches.push_back({(int)b, {}});
+                batches.back().lines.push_back(line);
+            }
+            return batches;
+        }
+
+        /*
+         * NHWC uint8 input of one batch: each crop is resized to the model height
+         * keeping its aspect and padded on the right, empty slots are all padding.
+         */
+        void fill(const std::vector<cv::Mat>& crops, const Batch& batch, std::vector<uint8_t>& data, uint8_t pad_value = 0, bool bgr2rgb = false) const
+        {
+            const Bucket& bucket = buckets_[batch.bucket];
+            const size_t image_size = (size_t)height_ * bucket.width * 3;
+            data.assign(image_size * bucket.batch, pad_value);
+            for (size_t i = 0; i < batch.lines.size(); i++)
+            {
+                const LineSlot& line = batch.lines[i];
+                cv::Mat image(height_, bucket.width, CV_8UC3, data.data() + i * image_size);
+                cv::Mat roi = image(cv::Rect(0, 0, line.width, height_));
+                cv::resize(crops[line.index], roi, cv::Size(line.width, height_));
+                if (bgr2rgb)
+                    cv::cvtColor(roi, roi, cv::COLOR_BGR2RGB);
+            }
+        }
+
+        /* output steps that see the line, the rest only see padding */
+        int valid_steps(const Batch& batch, int line, int steps) const
+        {
+            const int width = buckets_[batch.bucket].width;
+            return std::min(steps, (batch.lines[line].width * steps + width - 1) / width);
+        }
+
+    private:
+        int height_;
+        std::vector<Bucket> buckets_;
+    };
+
+    class CTCDecoder
+    {
+    public:
+        /*
+         * Class c is dict[c - offset], the blank is class `blank`. With logits the
+         * scores are pre-softmax (log-softmax works too), otherwise probabilities.
+         */
+        CTCDecoder(const std::vector<std::string>& dict, int offset = 0, int blank = 0, bool logits = false)
+            : dict_(dict), offset_(offset), blank_(blank), logits_(logits)
+        {
+        }
+
+        /* [batch, steps, classes] output, valid_steps[b] steps of line b are decoded, beam_width <= 1 is greedy */
+        void decode(const float* output, int batch, int steps, int classes, const int* valid_steps, int beam_width, std::vector<TextLine>& lines)
+        {
+            lines.resize(batch);
+            for (int b = 0; b < batch; b++)
+            {
+                const float* seq = output + (size_t)b * steps * classes;
+                const int n = valid_steps ? valid_steps[b] : steps;
+                if (beam_width > 1)
+                    beam(seq, n, classes, beam_width, lines[b]);
+                else
+                    greedy(seq, n, classes, lines[b]);
+            }
+        }
+
+        /* best class per step, repeats merged and blanks dropped */
+        void greedy(const float* seq, int steps, int classes, TextLine& line) const
+        {
+            line.text.clear();
+            float score = 0.f;
+            int count = 0;
+            int last = blank_;
+            for (int t = 0; t < steps; t++)
+            {
+                const float* row = seq + (size_t)t * classes;
+                float max_value;
+                const int index = simd::argmax(row, classes, &max_value);
+                if (index != blank_ && index != last)
+                {
+                    append(index, line.text);
+                    score += logits_ ? 1.f / exp_sum(row, classes, max_value) : max_value;
+                    count++;
+                }
+                last = index;
+            }
+            line.score = count > 0 ? score / count : 0.f;
+        }
+
+        /*
+         * Prefix beam search in log space. Per step only the `width` best classes
+         * and the blank extend the beams, and the `width` best prefixes are kept.
+         */
+        void beam(const float* seq, int steps, int classes, int width, TextLine& line)
+        {
+            const float none = -FLT_MAX;
+            auto log_add = [none](float a, float b) {
+                if (a == none)
+                    return b;
+                if (b == none)
+                    return a;
+                const float m = std::max(a, b);
+                return m + std::log1p(std::exp(-std::fabs(a - b)));
+            };
+
+            std::map<std::vector<int>, Beam> beams, next;
+            beams[{}] = {0.f, none};
+            for (int t = 0; t < steps; t++)
+            {
+                step_candidates(seq + (size_t)t * classes, classes, width);
+                float blank_prob = none;
+                for (const auto& c : candidates_)
+                {
+                    if ((int)c.id == blank_)
+                        blank_prob = c.score;
+                }
+
+                next.clear();
+                for (const auto& entry : beams)
+                {
+                    const std::vector<int>& prefix = entry.first;
+                    const Beam& b = entry.second;
+                    const float total = log_add(b.blank, b.label);
+                    const int last = prefix.empty() ? -1 : prefix.back();
+
+                    Beam& same = next.emplace(prefix, Beam{none, none}).first->second;
+                    same.blank = log_add(same.blank, total + blank_prob);
+
+                    for (const auto& c : candidates_)
+                    {
+                        const int label = (int)c.id;
+                        if (label == blank_)
+                            continue;
+                        std::vector<int> extended = prefix;
+                        extended.push_back(label);
+                        Beam& ext = next.emplace(extended, Beam{none, none}).first->second;
+                        if (label == last)
+                        {
+                            /* a repeat needs a blank in between, otherwise it merges into the prefix */
+                            ext.label = log_add(ext.label, b.blank + c.score);
+                            same.label = log_add(same.label, b.label + c.score);
+                        }
+                        else
+                        {
+                            ext.label = log_add(ext.label, total + c.score);
+                        }
+                    }
+                }
+
+                ranked_.clear();
+                for (const auto& entry : next)
+                {
+                    ranked_.push_back({log_add(entry.second.blank, entry.second.label), &entry});
+                }
+                const size_t keep = std::min(ranked_.size(), (size_t)width);
+                std::partial_sort(ranked_.begin(), ranked_.begin() + keep, ranked_.end(), [](const Ranked& a, const Ranked& b) { return a.first > b.first; });
+                beams.clear();
+                for (size_t i = 0; i < keep; i++)
+                {
+                    beams.insert(*ranked_[i].second);
+                }
+            }
+
+            line.text.clear();
+            line.score = 0.f;
+            float best = none;
+            const std::vector<int>* labels = nullptr;
+            for (const auto& entry : beams)
+            {
+                const float total = log_add(entry.second.blank, entry.second.label);
+                if (labels == nullptr || total > best)
+                {
+                    best = total;
+                    labels = &entry.first;
+                }
+            }
+            if (labels == nullptr)
+                return;
+            for (int label : *labels)
+            {
+                append(label, line.text);
+            }
+            line.score = steps > 0 ? std::exp(best / steps) : 0.f;
+        }
+
+    private:
+        /* log probability of a prefix over the paths ending in a blank / in its last label */
+        struct Beam
+        {
+            float blank;
+            float label;
+        };
+        typedef std::pair<float, const std::pair<const std::vector<int>, Beam>*> Ranked;
+
+        void append(int label, std::string& text) const
+        {
+            const int index = label - offset_;
+            if (index >= 0 && index < (int)dict_.size())
+                text += dict_[index];
+        }
+
+        /* sum(exp(row - max)), the softmax denominator of a logit row */
+        static float exp_sum(const float* row, int n, float max_value)
+        {
+            float sum = 0.f;
+            int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+            const simd::v4f m = simd::set1(max_value);
+            simd::v4f acc = simd::set1(0.f);
+            for (; i + 4 <= n; i += 4)
+            {
+                acc = simd::add(acc, simd::exp(simd::sub(simd::load(row + i), m)));
+            }
+            sum = simd::reduce_add(acc);
+#endif
+            for (; i < n; i++)
+            {
+                sum += fast_math::exp_poly(row[i] - max_value);
+            }
+            return sum;
+        }
+
+        /* log probabilities of the `width` best classes of a step and of the blank */
+        void step_candidates(const float* row, int classes, int width)
+        {
+            classification::topk(row, classes, width, candidates_);
+            bool has_blank = false;
+            for (const auto& c : candidates_)
+            {
+                has_blank = has_blank || (int)c.id == blank_;
+            }
+            if (!has_blank)
+                candidates_.push_back({(uint32_t)blank_, row[blank_]});
+
+            if (logits_)
+                classification::softmax_topk(row, classes, candidates_);
+            for (auto& c : candidates_)
+            {
+                c.score = std::log(std::max(c.score, FLT_MIN));
+            }
+        }
+
+        std::vector<std::string> dict_;
+        int offset_;
+        int blank_;
+        bool logits_;
+
+        std::vector<classification::score> candidates_;
+        std::vector<Ranked> ranked_;
+    };
+} // namespace ocr
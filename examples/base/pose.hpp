@@ -28,6 +28,8 @@
 #include <string>
 #include <iostream>
 
+#include "base/simd.hpp"
+
 namespace pose
 {
     typedef struct
@@ -149,6 +151,240 @@ namespace pose
         }
     }
 
+    enum HeatmapRefine
+    {
+        REFINE_NONE = 0, /* integer argmax */
+        REFINE_DARK = 1, /* Taylor expansion of the log of the smoothed heatmap around the argmax (DARK) */
+    };
+
+    /* reflect 101 border, like cv::GaussianBlur */
+    static inline int reflect_101(int i, int n)
+    {
+        if (n == 1)
+            return 0;
+        while (i < 0 || i >= n)
+        {
+            i = i < 0 ? -i : 2 * n - 2 - i;
+        }
+        return i;
+    }
+
+    /* heatmap smoothed by a separable gaussian at one pixel, only the few pixels DARK needs are ever blurred */
+    static inline float blurred_at(const float* plane, int width, int height, const float* kernel, int radius, int y, int x)
+    {
+        float sum = 0.f;
+        for (int i = -radius; i <= radius; i++)
+        {
+            const float* row = plane + (size_t)reflect_101(y + i, height) * width;
+            float line = 0.f;
+            for (int j = -radius; j <= radius; j++)
+            {
+                line += kernel[j + radius] * row[reflect_101(x + j, width)];
+            }
+            sum += kernel[i + radius] * line;
+        }
+        return sum;
+    }
+
+    /*
+     * DARK refinement of the peak (x, y) of one plane: the heatmap is smoothed
+     * with the gaussian it was trained with, and the log of it is taken as a
+     * quadratic around the peak, the offset is -H^-1 * grad. Peaks too close to
+     * the border, or not a maximum of the smoothed map, stay as they are.
+     */
+    static inline void refine_dark(const float* plane, int width, int height, const float* kernel, int radius, ai_point_t& peak)
+    {
+        const int px = (int)peak.x;
+        const int py = (int)peak.y;
+        if (px < 2 || px >= width - 2 || py < 2 || py >= height - 2)
+            return;
+
+        auto h = [&](int dy, int dx) {
+            return std::log(std::max(blurred_at(plane, width, height, kernel, radius, py + dy, px + dx), 1e-10f));
+        };
+        const float center = h(0, 0);
+        const float dx = 0.5f * (h(0, 1) - h(0, -1));
+        const float dy = 0.5f * (h(1, 0) - h(-1, 0));
+        const float dxx = 0.25f * (h(0, 2) - 2 * center + h(0, -2));
+        const float dyy = 0.25f * (h(2, 0) - 2 * center + h(-2, 0));
+        const float dxy = 0.25f * (h(1, 1) - h(-1, 1) - h(1, -1) + h(-1, -1));
+        const float det = dxx * dyy - dxy * dxy;
+        if (!(dxx < 0.f && det > 0.f))
+            return;
+
+        /* the true peak is within half a pixel of the argmax, larger offsets come from the border padding of the blur */
+        const float ox = -(dyy * dx - dxy * dy) / det;
+        const float oy = -(dxx * dy - dxy * dx) / det;
+        if (std::fabs(ox) > 0.5f || std::fabs(oy) > 0.5f)
+            return;
+        peak.x += ox;
+        peak.y += oy;
+    }
+
+    /*
+     * Peaks of a batch of [batch, channels, height, width] heatmaps, one per
+     * channel, in heatmap pixels; peaks holds batch * channels points. Planes
+     * are visited in memory order with the SIMD argmax, so the whole tensor is
+     * swept once, and the refinement only touches the neighbourhood of each
+     * peak. blur_kernel is the DARK smoothing size, 11 for 64x48 maps.
+     */
+    static inline void heatmap_peaks(const float* data, int batch, int channels, int height, int width, ai_point_t* peaks, int refine = REFINE_DARK, int blur_kernel = 11)
+    {
+        const int radius = std::max(blur_kernel / 2, 0);
+        std::vector<float> kernel(2 * radius + 1);
+        const float sigma = 0.3f * ((blur_kernel - 1) * 0.5f - 1.f) + 0.8f;
+        float kernel_sum = 0.f;
+        for (int i = -radius; i <= radius; i++)
+        {
+            kernel[i + radius] = std::exp(-(float)(i * i) / (2.f * sigma * sigma));
+            kernel_sum += kernel[i + radius];
+        }
+        for (auto& k : kernel)
+        {
+            k /= kernel_sum;
+        }
+
+        const int area = width * height;
+        for (int p = 0; p < batch * channels; p++)
+        {
+            const float* plane = data + (size_t)p * area;
+            float max_value;
+            const int index = simd::argmax(plane, area, &max_value);
+            ai_point_t& peak = peaks[p];
+            peak.x = (float)(index % width);
+            peak.y = (float)(index / width);
+            peak.score = max_value;
+            if (refine == REFINE_DARK)
+                refine_dark(plane, width, height, kernel.data(), radius, peak);
+        }
+    }
+
+    /*
+     * [batch, height, width, channels] heatmaps: the maxima of all channels are
+     * tracked together while the pixels are read once. The DARK refinement
+     * needs planar maps and is not applied here.
+     */
+    static inline void heatmap_peaks_interleaved(const float* data, int batch, int channels, int height, int width, ai_point_t* peaks)
+    {
+        std::vector<float> best(channels), index(channels);
+        const int area = width * height;
+        for (int b = 0; b < batch; b++)
+        {
+            const float* map = data + (size_t)b * area * channels;
+            std::copy(map, map + channels, best.begin());
+            std::fill(index.begin(), index.end(), 0.f);
+            for (int i = 1; i < area; i++)
+            {
+                const float* pixel = map + (size_t)i * channels;
+                const float position = (float)i;
+                int c = 0;
+#if defined(AX_SAMPLES_SIMD)
+                const simd::v4f vposition = simd::set1(position);
+                for (; c + 4 <= channels; c += 4)
+                {
+                    simd::v4f v = simd::load(pixel + c);
+                    simd::v4f m = simd::load(best.data() + c);
+                    simd::store(index.data() + c, simd::select_gt(v, m, vposition, simd::load(index.data() + c)));
+                    simd::store(best.data() + c, simd::max(v, m));
+                }
+#endif
+                for (; c < channels; c++)
+                {
+                    if (pixel[c] > best[c])
+                    {
+                        best[c] = pixel[c];
+                        index[c] = position;
+                    }
+                }
+            }
+
+            for (int c = 0; c < channels; c++)
+            {
+                const int i = (int)index[c];
+                peaks[b * channels + c] = {(float)(i % width), (float)(i / width), best[c]};
+            }
+        }
+    }
+
+    /*
+     * Top-down crop of a person box like mmpose: the box is widened to the
+     * model aspect and scaled by `padding`; affine maps the image to the model
+     * input and inverse maps model input pixels back to the image.
+     */
+    static inline void crop_transform(const cv::Rect2f& box, int input_w, int input_h, cv::Mat& affine, cv::Mat& inverse, float padding = 1.25f)
+    {
+        const float cx = box.x + box.width * 0.5f;
+        const float cy = box.y + box.height * 0.5f;
+        const float aspect = (float)input_w / input_h;
+        float w = box.width;
+        float h = box.height;
+        if (w > h * aspect)
+            h = w / aspect;
+        else
+            w = h * aspect;
+        w *= padding;
+        h *= padding;
+
+        cv::Point2f src[3] = {{cx, cy}, {cx, cy - h * 0.5f}, {cx - w * 0.5f, cy - h * 0.5f}};
+        cv::Point2f dst[3] = {{input_w * 0.5f, input_h * 0.5f}, {input_w * 0.5f, 0.f}, {0.f, 0.f}};
+        affine = cv::getAffineTransform(src, dst);
+        cv::invertAffineTransform(affine, inverse);
+    }
+
+    /*
+     * SimCC heads of a batch of crops: [batch, joints, wx] and [batch, joints, wy]
+     * classification vectors over the input width / height. Each vector goes
+     * through the SIMD argmax, or with soft_argmax the expectation of
+     * softmax(beta * v). Keypoints come out in image pixels through the
+     * per-person inverse crop transform (2x3 CV_64F, as from crop_transform),
+     * or in model input pixels when inverse is null. The score is the mean of
+     * the x and y maxima.
+     */
+    static inline void simcc_decode(const float* simcc_x, const float* simcc_y, int batch, int joints, int wx, int wy, int input_w, int input_h, const cv::Mat* inverse, ai_point_t* keypoints, bool soft_argmax = false, float beta = 1.f)
+    {
+        const float scale_x = (float)input_w / wx;
+        const float scale_y = (float)input_h / wy;
+        std::vector<float> scaled;
+
+        auto locate = [&](const float* v, int n, float& max_value) -> float {
+            const int index = simd::argmax(v, n, &max_value);
+            if (!soft_argmax)
+                return (float)index;
+            if (beta == 1.f)
+                return simd::dfl_expectation(v, n);
+            scaled.resize(n);
+            for (int i = 0; i < n; i++)
+            {
+                scaled[i] = v[i] * beta;
+            }
+            return simd::dfl_expectation(scaled.data(), n);
+        };
+
+        for (int b = 0; b < batch; b++)
+        {
+            double m[6] = {1, 0, 0, 0, 1, 0};
+            if (inverse)
+            {
+                const double* r0 = inverse[b].ptr<double>(0);
+                const double* r1 = inverse[b].ptr<double>(1);
+                std::copy(r0, r0 + 3, m);
+                std::copy(r1, r1 + 3, m + 3);
+            }
+
+            for (int k = 0; k < joints; k++)
+            {
+                const size_t row = (size_t)b * joints + k;
+                float max_x, max_y;
+                const float x = locate(simcc_x + row * wx, wx, max_x) * scale_x;
+                const float y = locate(simcc_y + row * wy, wy, max_y) * scale_y;
+                ai_point_t& kp = keypoints[row];
+                kp.x = (float)(m[0] * x + m[1] * y + m[2]);
+                kp.y = (float)(m[3] * x + m[4] * y + m[5]);
+                kp.score = (max_x + max_y) * 0.5f;
+            }
+        }
+    }
+
     static inline void draw_result(cv::Mat img, ai_body_parts_s& pose, int joints_num, int model_w, int model_h)
     {
         for (int i = 0; i < joints_num; i++)
@@ -365,20 +601,36 @@ namespace pose
     {
         int heatmap_width = img_w / 4;
         int heatmap_height = img_h / 4;
-        int max_idx_width, max_idx_height;
-        float max_score;
 
-        ai_point_t kp;
-        for (int c = 0; c < joint_num; ++c)
+        std::vector<ai_point_t> peaks(joint_num);
+        heatmap_peaks(data, 1, joint_num, heatmap_height, heatmap_width, peaks.data(), REFINE_DARK);
+        for (auto& kp : peaks)
         {
-            find_max_2d(data, heatmap_width, heatmap_height, &max_idx_width, &max_idx_height, &max_score, c);
-            kp.x = (float)max_idx_width / (float)heatmap_width;
-            kp.y = (float)max_idx_height / (float)heatmap_height;
-            kp.score = max_score;
+            kp.x /= (float)heatmap_width;
+            kp.y /= (float)heatmap_height;
             pose.keypoints.push_back(kp);
+        }
+    }
+
+    /* batch person crops of one [batch, joint_num, img_h / 4, img_w / 4] output, decoded in a single sweep */
+    static inline void post_process(const float* data, int batch, std::vector<ai_body_parts_s>& poses, int joint_num, int img_h, int img_w)
+    {
+        int heatmap_width = img_w / 4;
+        int heatmap_height = img_h / 4;
 
-            //            std::cout << "x: " << pose.keypoints[c].x << ", y: " << pose.keypoints[c].y << ", score: "
-            //                      << pose.keypoints[c].score << std::endl;
+        std::vector<ai_point_t> peaks((size_t)batch * joint_num);
+        heatmap_peaks(data, batch, joint_num, heatmap_height, heatmap_width, peaks.data(), REFINE_DARK);
+        poses.resize(batch);
+        for (int b = 0; b < batch; b++)
+        {
+            poses[b].keypoints.clear();
+            for (int j = 0; j < joint_num; j++)
+            {
+                ai_point_t kp = peaks[(size_t)b * joint_num + j];
+                kp.x /= (float)heatmap_width;
+                kp.y /= (float)heatmap_height;
+                poses[b].keypoints.push_back(kp);
+            }
         }
     }
 
@@ -386,20 +638,14 @@ namespace pose
     {
         int heatmap_width = img_w / 4;
         int heatmap_height = img_h / 4;
-        int max_idx_width, max_idx_height;
-        float max_score;
 
-        ai_point_t kp;
-        for (int c = 0; c < joint_num; ++c)
+        std::vector<ai_point_t> peaks(joint_num);
+        heatmap_peaks(data, 1, joint_num, heatmap_height, heatmap_width, peaks.data(), REFINE_DARK);
+        for (auto& kp : peaks)
         {
-            find_max_2d(data, heatmap_width, heatmap_height, &max_idx_width, &max_idx_height, &max_score, c);
-            kp.x = (float)max_idx_width / (float)heatmap_width;
-            kp.y = (float)max_idx_height / (float)heatmap_height;
-            kp.score = max_score;
+            kp.x /= (float)heatmap_width;
+            kp.y /= (float)heatmap_height;
             pose.keypoints.push_back(kp);
-
-            //            std::cout << "x: " << pose.keypoints[c].x << ", y: " << pose.keypoints[c].y << ", score: "
-            //                      << pose.keypoints[c].score << std::endl;
         }
     }
 
@@ -0,0 +1,280 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "base/simd.hpp"
+
+/*
+ * Linear projection of feature vectors (ViT patch tokens and the like) onto a
+ * few principal components, for visualization. The basis is fit once, from
+ * one batch or accumulated over many, can be saved and loaded, and projecting
+ * a frame is then a small GEMM instead of a new eigen-decomposition.
+ */
+namespace projection
+{
+    /*
+     * Patch grid of a token sequence: tokens = prefix + grid_h * grid_w, where
+     * the prefix is nothing, a class token, or a class token and 4 registers,
+     * and the grid has the aspect of the input.
+     */
+    static bool token_grid(int tokens, int input_h, int input_w, int& grid_h, int& grid_w, int& prefix)
+    {
+        for (int p : {0, 1, 5})
+        {
+            const int n = tokens - p;
+            if (n <= 0)
+                continue;
+            const int patch = (int)std::lround(std::sqrt((double)input_h * input_w / n));
+            if (patch > 0 && (input_h / patch) * (input_w / patch) == n)
+            {
+                grid_h = input_h / patch;
+                grid_w = input_w / patch;
+                prefix = p;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    class PCAProjector
+    {
+    public:
+        explicit PCAProjector(int components = 3)
+            : components_(components)
+        {
+        }
+
+        /* drops the accumulated statistics and the basis */
+        void reset()
+        {
+            dim_ = 0;
+            count_ = 0;
+            sum_.clear();
+            scatter_.release();
+            mean_.clear();
+            basis_.clear();
+            offset_.clear();
+        }
+
+        /* accumulates `rows` vectors of `dim` floats, the basis is updated by solve() */
+        bool partial_fit(const float* x, int rows, int dim)
+        {
+            if (rows <= 0)
+                return true;
+            if (count_ == 0)
+            {
+                dim_ = dim;
+                sum_.assign(dim, 0.0);
+                scatter_ = cv::Mat::zeros(dim, dim, CV_64FC1);
+            }
+            else if (dim != dim_)
+            {
+                return false;
+            }
+
+            for (int r = 0; r < rows; r++)
+            {
+                const float* v = x + (size_t)r * dim;
+                for (int i = 0; i < dim; i++)
+                {
+                    sum_[i] += v[i];
+                }
+            }
+
+            cv::Mat batch(rows, dim, CV_32FC1, (void*)x);
+            cv::Mat product;
+            cv::mulTransposed(batch, product, true, cv::noArray(), 1.0, CV_64FC1);
+            scatter_ += product;
+            count_ += rows;
+            return true;
+        }
+
+        /* eigen-decomposition of the covariance accumulated so far */
+        bool solve()
+        {
+            if (count_ < 2 || components_ > dim_)
+                return false;
+
+            std::vector<double> mean(dim_);
+            for (int i = 0; i < dim_; i++)
+            {
+                mean[i] = sum_[i] / (double)count_;
+            }
+
+            cv::Mat covariance(dim_, dim_, CV_64FC1);
+            for (int i = 0; i < dim_; i++)
+            {
+                const double* s = scatter_.ptr<double>(i);
+                double* c = covariance.ptr<double>(i);
+                for (int j = 0; j < dim_; j++)
+                {
+                    c[j] = (s[j] - (double)count_ * mean[i] * mean[j]) / (double)(count_ - 1);
+                }
+            }
+
+            cv::Mat eigenvalues, eigenvectors;
+            if (!cv::eigen(covariance, eigenvalues, eigenvectors))
+                return false;
+
+            /* eigenvectors come in descending order, signs are fixed so refits give the same colors */
+            mean_.assign(mean.begin(), mean.end());
+            basis_.resize((size_t)components_ * dim_);
+            for (int c = 0; c < components_; c++)
+            {
+                const double* e = eigenvectors.ptr<double>(c);
+                int peak = 0;
+                for (int i = 1; i < dim_; i++)
+                {
+                    if (std::fabs(e[i]) > std::fabs(e[peak]))
+                        peak = i;
+                }
+                const double sign = e[peak] < 0 ? -1.0 : 1.0;
+                for (int i = 0; i < dim_; i++)
+                {
+                    basis_[(size_t)c * dim_ + i] = (float)(sign * e[i]);
+                }
+            }
+            update_offset();
+            return true;
+        }
+
+        /* fits a fresh basis on one batch */
+        bool fit(const float* x, int rows, int dim)
+        {
+            reset();
+            return partial_fit(x, rows, dim) && solve();
+        }
+
+        bool fitted() const
+        {
+            return !basis_.empty();
+        }
+
+        int dim() const
+        {
+            return dim_;
+        }
+
+        int components() const
+        {
+            return components_;
+        }
+
+        /* writes mean and basis with cv::FileStorage (.yml, .xml or .json, optionally .gz) */
+        bool save(const std::string& path) const
+        {
+            if (!fitted())
+                return false;
+            cv::FileStorage fs(path, cv::FileStorage::WRITE);
+            if (!fs.isOpened())
+                return false;
+            fs << "mean" << cv::Mat(1, dim_, CV_32FC1, (void*)mean_.data());
+            fs << "basis" << cv::Mat(components_, dim_, CV_32FC1, (void*)basis_.data());
+            fs.release();
+            return true;
+        }
+
+        bool load(const std::string& path)
+        {
+            cv::FileStorage fs(path, cv::FileStorage::READ);
+            if (!fs.isOpened())
+                return false;
+            cv::Mat mean, basis;
+            fs["mean"] >> mean;
+            fs["basis"] >> basis;
+            if (mean.empty() || basis.empty() || mean.type() != CV_32FC1 || basis.type() != CV_32FC1 || mean.total() != (size_t)basis.cols)
+                return false;
+
+            reset();
+            dim_ = basis.cols;
+            components_ = basis.rows;
+            mean_.assign((const float*)mean.data, (const float*)mean.data + dim_);
+            basis_.assign((const float*)basis.data, (const float*)basis.data + basis.total());
+            update_offset();
+            return true;
+        }
+
+        /* out[r * components + c] = (x[r] - mean) . basis[c] */
+        void project(const float* x, int rows, float* out) const
+        {
+            for (int r = 0; r < rows; r++)
+            {
+                const float* v = x + (size_t)r * dim_;
+                for (int c = 0; c < components_; c++)
+                {
+                    out[(size_t)r * components_ + c] = dot(v, basis_.data() + (size_t)c * dim_, dim_) - offset_[c];
+                }
+            }
+        }
+
+    private:
+        static float dot(const float* a, const float* b, int n)
+        {
+            float sum = 0.f;
+            int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+            simd::v4f acc0 = simd::set1(0.f);
+            simd::v4f acc1 = simd::set1(0.f);
+            for (; i + 8 <= n; i += 8)
+            {
+                acc0 = simd::fmadd(simd::load(a + i), simd::load(b + i), acc0);
+                acc1 = simd::fmadd(simd::load(a + i + 4), simd::load(b + i + 4), acc1);
+            }
+            sum = simd::reduce_add(simd::add(acc0, acc1));
+#endif
+            for (; i < n; i++)
+            {
+                sum += a[i] * b[i];
+            }
+            return sum;
+        }
+
+        /* the mean is folded into one constant per component, inputs are used as they are */
+        void update_offset()
+        {
+            offset_.resize(components_);
+            for (int c = 0; c < components_; c++)
+            {
+                offset_[c] = dot(mean_.data(), basis_.data() + (size_t)c * dim_, dim_);
+            }
+        }
+
+        int components_;
+        int dim_ = 0;
+
+        /* running statistics for partial_fit */
+        int64_t count_ = 0;
+        std::vector<double> sum_;
+        cv::Mat scatter_;
+
+        /* basis, row major components x dim */
+        std::vector<float> mean_;
+        std::vector<float> basis_;
+        std::vector<float> offset_;
+    };
+} // namespace projection
@@ -0,0 +1,128 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+#include "base/simd.hpp"
+
+/*
+ * Helpers for decoding NPU outputs that stay quantized (int8 / uint8 / int16)
+ * instead of being dequantized to float32 by the toolchain. Every function has
+ * a float overload that passes the data through, so decoders can be written
+ * once as templates over the stored type.
+ */
+namespace quant
+{
+    /* per tensor affine quantization, real = (q - zero_point) * scale, scale > 0 */
+    typedef struct QuantParam
+    {
+        float scale;
+        int zero_point;
+    } QuantParam;
+
+    static const QuantParam QUANT_NONE = {1.f, 0};
+
+    static inline float dequantize(float q, const QuantParam&)
+    {
+        return q;
+    }
+
+    template<typename T>
+    static inline float dequantize(T q, const QuantParam& qp)
+    {
+        return (float)((int)q - qp.zero_point) * qp.scale;
+    }
+
+    /* float rows are used in place, stored rows are converted into buf */
+    static inline const float* dequantize(const float* src, int /*n*/, const QuantParam&, float*)
+    {
+        return src;
+    }
+
+    template<typename T>
+    static inline const float* dequantize(const T* src, int n, const QuantParam& qp, float* buf)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            buf[i] = (float)((int)src[i] - qp.zero_point) * qp.scale;
+        }
+        return buf;
+    }
+
+    /*
+     * Stored value form of the test `real >= value`, so candidates can be
+     * rejected without converting them. The integer cut is one step loose so
+     * rounding never drops a candidate; survivors are checked again in float.
+     */
+    static inline float threshold(float value, const QuantParam&, const float*)
+    {
+        return value;
+    }
+
+    template<typename T>
+    static inline int threshold(float value, const QuantParam& qp, const T*)
+    {
+        if (value <= -FLT_MAX)
+            return INT_MIN;
+        if (value >= FLT_MAX)
+            return INT_MAX;
+        double q = std::ceil((double)value / qp.scale + qp.zero_point) - 1.0;
+        q = std::max(std::min(q, (double)(INT_MAX / 2)), (double)(INT_MIN / 2));
+        return (int)q;
+    }
+
+    /* index of the first maximum, same tie-break as a scalar `>` scan; -1 when n <= 0 */
+    static inline int argmax(const float* src, int n, float* max_value)
+    {
+        if (n <= 0)
+        {
+            *max_value = -FLT_MAX;
+            return -1;
+        }
+        return simd::argmax(src, n, max_value);
+    }
+
+    template<typename T>
+    static inline int argmax(const T* src, int n, int* max_value)
+    {
+        if (n <= 0)
+        {
+            *max_value = INT_MIN;
+            return -1;
+        }
+        int index = 0;
+        int m = src[0];
+        for (int i = 1; i < n; i++)
+        {
+            if (src[i] > m)
+            {
+                m = src[i];
+                index = i;
+            }
+        }
+        *max_value = m;
+        return index;
+    }
+} // namespace quant
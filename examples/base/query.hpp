@@ -0,0 +1,158 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "base/simd.hpp"
+
+/*
+ * Detection selection for end-to-end heads (DETR, RT-DETR, YOLOv10 one-to-one)
+ * that need no NMS: the k best of a [queries, classes] score matrix above a
+ * threshold. Candidates go through a k entry min-heap, so nothing is stored or
+ * sorted beyond the k winners, and rows that cannot beat the weakest winner
+ * are skipped four scores at a time.
+ */
+namespace query
+{
+    struct Candidate
+    {
+        uint32_t query;
+        uint32_t label;
+        float score;
+    };
+
+    class TopK
+    {
+    public:
+        explicit TopK(int k)
+            : k_(std::max(k, 0))
+        {
+            heap_.reserve(k_);
+        }
+
+        void clear(float threshold = -FLT_MAX)
+        {
+            heap_.clear();
+            threshold_ = threshold;
+        }
+
+        int k() const
+        {
+            return k_;
+        }
+
+        /* a candidate must score above this to get in */
+        float floor() const
+        {
+            if (k_ == 0)
+                return FLT_MAX;
+            return (int)heap_.size() < k_ ? threshold_ : std::max(threshold_, heap_.front().score);
+        }
+
+        void push(uint32_t query, uint32_t label, float score)
+        {
+            if (!(score > floor()))
+                return;
+            if ((int)heap_.size() == k_)
+            {
+                std::pop_heap(heap_.begin(), heap_.end(), stronger);
+                heap_.back() = {query, label, score};
+            }
+            else
+            {
+                heap_.push_back({query, label, score});
+            }
+            std::push_heap(heap_.begin(), heap_.end(), stronger);
+        }
+
+        /* the winners, best first; the heap is consumed, clear() before reuse */
+        std::vector<Candidate>& sorted()
+        {
+            std::sort_heap(heap_.begin(), heap_.end(), stronger);
+            return heap_;
+        }
+
+    private:
+        /* higher score first, lower query then lower label on ties */
+        static bool stronger(const Candidate& a, const Candidate& b)
+        {
+            if (a.score != b.score)
+                return a.score > b.score;
+            return a.query != b.query ? a.query < b.query : a.label < b.label;
+        }
+
+        int k_;
+        float threshold_ = -FLT_MAX;
+        std::vector<Candidate> heap_;
+    };
+
+    /*
+     * Every (query, class) pair of the matrix competes, a query can win with
+     * several classes. Rows are `stride` floats apart, the first `classes` are
+     * scores; queries are numbered from `first_query`.
+     */
+    static void select_all(const float* scores, int queries, int classes, int stride, TopK& top, uint32_t first_query = 0)
+    {
+        for (int q = 0; q < queries; q++)
+        {
+            const float* row = scores + (size_t)q * stride;
+            int c = 0;
+#if defined(AX_SAMPLES_SIMD)
+            for (; c + 4 <= classes; c += 4)
+            {
+                if (!simd::any_ge(simd::load(row + c), simd::set1(top.floor())))
+                    continue;
+                for (int j = c; j < c + 4; j++)
+                {
+                    top.push(first_query + q, j, row[j]);
+                }
+            }
+#endif
+            for (; c < classes; c++)
+            {
+                top.push(first_query + q, c, row[c]);
+            }
+        }
+    }
+
+    /* one-to-one heads: a query competes with its best class only */
+    static void select_best(const float* scores, int queries, int classes, int stride, TopK& top, uint32_t first_query = 0)
+    {
+        for (int q = 0; q < queries; q++)
+        {
+            const float* row = scores + (size_t)q * stride;
+            const float best = simd::reduce_max(row, classes);
+            if (!(best > top.floor()))
+                continue;
+            int label = 0;
+            while (row[label] != best)
+            {
+                label++;
+            }
+            top.push(first_query + q, label, best);
+        }
+    }
+} // namespace query
@@ -0,0 +1,234 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cfloat>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "base/simd.hpp"
+
+/*
+ * Semantic segmentation post-processing on CV_8UC1 label maps: channel argmax
+ * for score outputs (planar NCHW or interleaved NHWC), label maps straight
+ * from models that do the argmax themselves, and palette colorization that
+ * upsamples the labels with nearest neighbour on the fly, so the three
+ * channel overlay never has to be resized.
+ */
+namespace segmentation
+{
+    /* pixels without a class (out of range index, or below the score cut) */
+    static const uint8_t IGNORE_LABEL = 255;
+
+    /* pixels per block of the planar argmax, the running max stays in L1 */
+    static const int ARGMAX_BLOCK = 1024;
+
+    /*
+     * Argmax over `channels` planes of `pixels` scores each. Every plane is read
+     * sequentially while the running best score and index of a block of pixels
+     * stay in a small buffer. The first maximum wins ties; pixels whose best
+     * score is not above min_score get IGNORE_LABEL. channels must be <= 255.
+     */
+    static void argmax_planar(const float* src, int channels, int pixels, uint8_t* labels, float min_score = -FLT_MAX)
+    {
+        float best[ARGMAX_BLOCK];
+        float index[ARGMAX_BLOCK];
+
+        for (int begin = 0; begin < pixels; begin += ARGMAX_BLOCK)
+        {
+            const int count = std::min(ARGMAX_BLOCK, pixels - begin);
+            std::copy(src + begin, src + begin + count, best);
+            std::fill(index, index + count, 0.f);
+
+            for (int c = 1; c < channels; c++)
+            {
+                const float* plane = src + (size_t)c * pixels + begin;
+                const float label = (float)c;
+                int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+                const simd::v4f vlabel = simd::set1(label);
+                for (; i + 4 <= count; i += 4)
+                {
+                    simd::v4f v = simd::load(plane + i);
+                    simd::v4f b = simd::load(best + i);
+                    simd::store(index + i, simd::select_gt(v, b, vlabel, simd::load(index + i)));
+                    simd::store(best + i, simd::max(v, b));
+                }
+#endif
+                for (; i < count; i++)
+                {
+                    if (plane[i] > best[i])
+                    {
+                        best[i] = plane[i];
+                        index[i] = label;
+                    }
+                }
+            }
+
+            uint8_t* out = labels + begin;
+            for (int i = 0; i < count; i++)
+            {
+                out[i] = best[i] > min_score ? (uint8_t)index[i] : IGNORE_LABEL;
+            }
+        }
+    }
+
+    /*
+     * Integer domain form for outputs kept quantized (int8 / uint8 / int16). The
+     * argmax of an affine quantized tensor with a positive scale is the argmax
+     * of the stored values, so nothing is converted; min_score is a stored value.
+     */
+    template<typename T>
+    static void argmax_planar(const T* src, int channels, int pixels, uint8_t* labels, int min_score = INT32_MIN)
+    {
+        T best[ARGMAX_BLOCK];
+
+        for (int begin = 0; begin < pixels; begin += ARGMAX_BLOCK)
+        {
+            const int count = std::min(ARGMAX_BLOCK, pixels - begin);
+            uint8_t* out = labels + begin;
+            std::copy(src + begin, src + begin + count, best);
+            std::fill(out, out + count, (uint8_t)0);
+
+            for (int c = 1; c < channels; c++)
+            {
+                const T* plane = src + (size_t)c * pixels + begin;
+                for (int i = 0; i < count; i++)
+                {
+                    bool greater = plane[i] > best[i];
+                    best[i] = greater ? plane[i] : best[i];
+                    out[i] = greater ? (uint8_t)c : out[i];
+                }
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                out[i] = (int)best[i] > min_score ? out[i] : IGNORE_LABEL;
+            }
+        }
+    }
+
+    /* NHWC form, the channels of a pixel are contiguous already */
+    template<typename T, typename S>
+    static void argmax_interleaved(const T* src, int channels, int pixels, uint8_t* labels, S min_score)
+    {
+        for (int p = 0; p < pixels; p++)
+        {
+            const T* s = src + (size_t)p * channels;
+            int index = 0;
+            for (int c = 1; c < channels; c++)
+            {
+                if (s[c] > s[index])
+                    index = c;
+            }
+            labels[p] = s[index] > min_score ? (uint8_t)index : IGNORE_LABEL;
+        }
+    }
+
+    template<typename T>
+    static void argmax_interleaved(const T* src, int channels, int pixels, uint8_t* labels)
+    {
+        argmax_interleaved(src, channels, pixels, labels, std::numeric_limits<T>::lowest());
+    }
+
+    /* label maps produced by the model (int or float indices), unknown classes become IGNORE_LABEL */
+    template<typename T>
+    static void index_map(const T* src, int pixels, int num_classes, uint8_t* labels)
+    {
+        num_classes = std::min(num_classes, (int)IGNORE_LABEL);
+        for (int p = 0; p < pixels; p++)
+        {
+            labels[p] = src[p] >= 0 && src[p] < num_classes ? (uint8_t)src[p] : IGNORE_LABEL;
+        }
+    }
+
+    /* 1 where score > threshold, IGNORE_LABEL elsewhere, for single channel heads */
+    static void binarize(const float* src, int pixels, float threshold, uint8_t* labels)
+    {
+        for (int p = 0; p < pixels; p++)
+        {
+            labels[p] = src[p] > threshold ? 1 : IGNORE_LABEL;
+        }
+    }
+
+    /* nearest neighbour resize of a label map, never blends two classes */
+    static void resize_labels(const cv::Mat& labels, const cv::Size& size, cv::Mat& out)
+    {
+        cv::resize(labels, out, size, 0, 0, cv::INTER_NEAREST);
+    }
+
+    /* class colors in a 256 entry table, labels without a color map to black */
+    class Palette
+    {
+    public:
+        Palette(const cv::Vec3b* colors, int count)
+        {
+            std::fill(table, table + 256, cv::Vec3b(0, 0, 0));
+            std::copy(colors, colors + std::min(count, (int)IGNORE_LABEL), table);
+        }
+
+        const cv::Vec3b& operator[](uint8_t label) const
+        {
+            return table[label];
+        }
+
+        /* CV_8UC3 image of the labels at `size` (the label size when empty), nearest upsampling */
+        void colorize(const cv::Mat& labels, cv::Mat& bgr, cv::Size size = cv::Size()) const
+        {
+            if (size.area() == 0)
+                size = labels.size();
+            bgr.create(size, CV_8UC3);
+
+            std::vector<int> xmap(size.width);
+            for (int x = 0; x < size.width; x++)
+            {
+                xmap[x] = std::min((int)((int64_t)x * labels.cols / size.width), labels.cols - 1);
+            }
+
+            for (int y = 0; y < size.height; y++)
+            {
+                const int sy = std::min((int)((int64_t)y * labels.rows / size.height), labels.rows - 1);
+                const uint8_t* src = labels.ptr<uint8_t>(sy);
+                cv::Vec3b* dst = bgr.ptr<cv::Vec3b>(y);
+                if (size.width == labels.cols)
+                {
+                    for (int x = 0; x < size.width; x++)
+                    {
+                        dst[x] = table[src[x]];
+                    }
+                }
+                else
+                {
+                    for (int x = 0; x < size.width; x++)
+                    {
+                        dst[x] = table[src[xmap[x]]];
+                    }
+                }
+            }
+        }
+
+    private:
+        cv::Vec3b table[256];
+    };
+} // namespace segmentation
@@ -0,0 +1,307 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AX_SAMPLES_SIMD_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AX_SAMPLES_SIMD_SSE2 1
+#if defined(__AVX__)
+#include <immintrin.h>
+#define AX_SAMPLES_SIMD_AVX 1
+#endif
+#endif
+
+#if defined(AX_SAMPLES_SIMD_NEON) || defined(AX_SAMPLES_SIMD_SSE2)
+#define AX_SAMPLES_SIMD 1
+#endif
+
+/*
+ * Small 4-lane float helpers shared by the post-processing kernels.
+ * NEON is used on aarch64/armv7 boards, SSE2 (plus AVX for reductions when
+ * enabled) on x86 hosts, and every kernel has a scalar fallback.
+ */
+namespace simd
+{
+#if defined(AX_SAMPLES_SIMD_NEON)
+    typedef float32x4_t v4f;
+    typedef int32x4_t v4i;
+
+    static inline v4f load(const float* p) { return vld1q_f32(p); }
+    static inline void store(float* p, v4f a) { vst1q_f32(p, a); }
+    static inline v4f set1(float v) { return vdupq_n_f32(v); }
+    static inline v4f add(v4f a, v4f b) { return vaddq_f32(a, b); }
+    static inline v4f sub(v4f a, v4f b) { return vsubq_f32(a, b); }
+    static inline v4f mul(v4f a, v4f b) { return vmulq_f32(a, b); }
+#if defined(__aarch64__)
+    static inline v4f div(v4f a, v4f b) { return vdivq_f32(a, b); }
+    static inline v4f sqrt(v4f a) { return vsqrtq_f32(a); }
+#else
+    /* armv7 has no vector divide / sqrt, two newton steps on the estimates */
+    static inline v4f div(v4f a, v4f b)
+    {
+        float32x4_t r = vrecpeq_f32(b);
+        r = vmulq_f32(vrecpsq_f32(b, r), r);
+        r = vmulq_f32(vrecpsq_f32(b, r), r);
+        return vmulq_f32(a, r);
+    }
+    static inline v4f sqrt(v4f a)
+    {
+        float32x4_t r = vrsqrteq_f32(a);
+        r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, r), r), r);
+        r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, r), r), r);
+        /* zero lanes would give 0 * inf */
+        return vbslq_f32(vceqq_f32(a, vdupq_n_f32(0.f)), a, vmulq_f32(a, r));
+    }
+#endif
+    static inline v4f fmadd(v4f a, v4f b, v4f c) { return vmlaq_f32(c, a, b); } // a * b + c
+    static inline v4f max(v4f a, v4f b) { return vmaxq_f32(a, b); }
+    static inline v4f min(v4f a, v4f b) { return vminq_f32(a, b); }
+    static inline v4i to_int(v4f a) { return vcvtq_s32_f32(a); } // truncate toward zero
+    static inline v4f to_float(v4i a) { return vcvtq_f32_s32(a); }
+    static inline v4i add_int(v4i a, v4i b) { return vaddq_s32(a, b); }
+    static inline v4i sub_int(v4i a, v4i b) { return vsubq_s32(a, b); }
+    static inline v4i and_int(v4i a, v4i b) { return vandq_s32(a, b); }
+    static inline v4i set1_int(int32_t v) { return vdupq_n_s32(v); }
+    static inline v4f as_float(v4i a) { return vreinterpretq_f32_s32(a); }
+    static inline v4i as_int(v4f a) { return vreinterpretq_s32_f32(a); }
+    template<int N>
+    static inline v4i shift_left(v4i a) { return vshlq_n_s32(a, N); }
+    template<int N>
+    static inline v4i shift_right(v4i a) { return vshrq_n_s32(a, N); } // arithmetic
+    /* true when a >= b in any lane */
+    static inline bool any_ge(v4f a, v4f b)
+    {
+        uint32x4_t m = vcgeq_f32(a, b);
+        uint32x2_t r = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+        return (vget_lane_u32(r, 0) | vget_lane_u32(r, 1)) != 0;
+    }
+    /* lanes where a > b keep `t`, the others keep `f` */
+    static inline v4f select_gt(v4f a, v4f b, v4f t, v4f f) { return vbslq_f32(vcgtq_f32(a, b), t, f); }
+
+    static inline float reduce_max(v4f a)
+    {
+#if defined(__aarch64__)
+        return vmaxvq_f32(a);
+#else
+        float32x2_t m = vpmax_f32(vget_low_f32(a), vget_high_f32(a));
+        m = vpmax_f32(m, m);
+        return vget_lane_f32(m, 0);
+#endif
+    }
+
+    static inline float reduce_add(v4f a)
+    {
+#if defined(__aarch64__)
+        return vaddvq_f32(a);
+#else
+        float32x2_t s = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+        s = vpadd_f32(s, s);
+        return vget_lane_f32(s, 0);
+#endif
+    }
+#elif defined(AX_SAMPLES_SIMD_SSE2)
+    typedef __m128 v4f;
+    typedef __m128i v4i;
+
+    static inline v4f load(const float* p) { return _mm_loadu_ps(p); }
+    static inline void store(float* p, v4f a) { _mm_storeu_ps(p, a); }
+    static inline v4f set1(float v) { return _mm_set1_ps(v); }
+    static inline v4f add(v4f a, v4f b) { return _mm_add_ps(a, b); }
+    static inline v4f sub(v4f a, v4f b) { return _mm_sub_ps(a, b); }
+    static inline v4f mul(v4f a, v4f b) { return _mm_mul_ps(a, b); }
+    static inline v4f div(v4f a, v4f b) { return _mm_div_ps(a, b); }
+    static inline v4f sqrt(v4f a) { return _mm_sqrt_ps(a); }
+    static inline v4f fmadd(v4f a, v4f b, v4f c) { return _mm_add_ps(_mm_mul_ps(a, b), c); } // a * b + c
+    static inline v4f max(v4f a, v4f b) { return _mm_max_ps(a, b); }
+    static inline v4f min(v4f a, v4f b) { return _mm_min_ps(a, b); }
+    static inline v4i to_int(v4f a) { return _mm_cvttps_epi32(a); } // truncate toward zero
+    static inline v4f to_float(v4i a) { return _mm_cvtepi32_ps(a); }
+    static inline v4i add_int(v4i a, v4i b) { return _mm_add_epi32(a, b); }
+    static inline v4i sub_int(v4i a, v4i b) { return _mm_sub_epi32(a, b); }
+    static inline v4i and_int(v4i a, v4i b) { return _mm_and_si128(a, b); }
+    static inline v4i set1_int(int32_t v) { return _mm_set1_epi32(v); }
+    static inline v4f as_float(v4i a) { return _mm_castsi128_ps(a); }
+    static inline v4i as_int(v4f a) { return _mm_castps_si128(a); }
+    template<int N>
+    static inline v4i shift_left(v4i a) { return _mm_slli_epi32(a, N); }
+    template<int N>
+    static inline v4i shift_right(v4i a) { return _mm_srai_epi32(a, N); } // arithmetic
+    /* true when a >= b in any lane */
+    static inline bool any_ge(v4f a, v4f b) { return _mm_movemask_ps(_mm_cmpge_ps(a, b)) != 0; }
+    /* lanes where a > b keep `t`, the others keep `f` */
+    static inline v4f select_gt(v4f a, v4f b, v4f t, v4f f)
+    {
+        v4f mask = _mm_cmpgt_ps(a, b);
+        return _mm_or_ps(_mm_and_ps(mask, t), _mm_andnot_ps(mask, f));
+    }
+
+    static inline float reduce_max(v4f a)
+    {
+        a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+        a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(a);
+    }
+
+    static inline float reduce_add(v4f a)
+    {
+        a = _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+        a = _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(a);
+    }
+#endif
+
+#if defined(AX_SAMPLES_SIMD)
+    static inline v4f floor(v4f x)
+    {
+        v4f t = to_float(to_int(x));
+        return select_gt(t, x, sub(t, set1(1.f)), t);
+    }
+
+    /* cephes expf, max relative error ~2e-7 on [-87.3, 88.3] */
+    static inline v4f exp(v4f x)
+    {
+        x = min(x, set1(88.3762626647949f));
+        x = max(x, set1(-88.3762626647949f));
+
+        v4f fx = fmadd(x, set1(1.44269504088896341f), set1(0.5f));
+        fx = floor(fx);
+
+        x = sub(x, mul(fx, set1(0.693359375f)));
+        x = sub(x, mul(fx, set1(-2.12194440e-4f)));
+        v4f z = mul(x, x);
+
+        v4f y = set1(1.9875691500E-4f);
+        y = fmadd(y, x, set1(1.3981999507E-3f));
+        y = fmadd(y, x, set1(8.3334519073E-3f));
+        y = fmadd(y, x, set1(4.1665795894E-2f));
+        y = fmadd(y, x, set1(1.6666665459E-1f));
+        y = fmadd(y, x, set1(5.0000001201E-1f));
+        y = fmadd(y, z, x);
+        y = add(y, set1(1.f));
+
+        v4i e = add_int(to_int(fx), set1_int(127));
+        return mul(y, as_float(shift_left<23>(e)));
+    }
+#endif
+
+    /* max over src[0, n) */
+    static inline float reduce_max(const float* src, int n)
+    {
+        int i = 0;
+        float m = -FLT_MAX;
+#if defined(AX_SAMPLES_SIMD_AVX)
+        if (n >= 8)
+        {
+            __m256 vm = _mm256_loadu_ps(src);
+            for (i = 8; i + 8 <= n; i += 8)
+            {
+                vm = _mm256_max_ps(vm, _mm256_loadu_ps(src + i));
+            }
+            m = reduce_max(_mm_max_ps(_mm256_castps256_ps128(vm), _mm256_extractf128_ps(vm, 1)));
+        }
+#elif defined(AX_SAMPLES_SIMD)
+        if (n >= 4)
+        {
+            v4f vm = load(src);
+            for (i = 4; i + 4 <= n; i += 4)
+            {
+                vm = max(vm, load(src + i));
+            }
+            m = reduce_max(vm);
+        }
+#endif
+        for (; i < n; i++)
+        {
+            m = src[i] > m ? src[i] : m;
+        }
+        return m;
+    }
+
+    /* index of the first maximum in src[0, n), same tie-break as a scalar `>` scan */
+    static inline int argmax(const float* src, int n, float* max_value)
+    {
+        const float m = reduce_max(src, n);
+        int index = 0;
+        while (index < n - 1 && src[index] != m)
+        {
+            index++;
+        }
+        *max_value = m;
+        return index;
+    }
+
+    /*
+     * DFL expectation sum(i * softmax(src)[i]) over one side of the box.
+     * Agrees with detection::softmax() within 1e-5 bins, i.e. < 1e-3 px for
+     * strides up to 64; pred boxes are not bit-identical because of the
+     * polynomial exp and the different summation order.
+     */
+    static inline float dfl_expectation(const float* src, int reg_max)
+    {
+        const float alpha = reduce_max(src, reg_max);
+        float denominator = 0.f;
+        float dis_sum = 0.f;
+        int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        if (reg_max >= 4)
+        {
+            v4f va = set1(alpha);
+            v4f vden = set1(0.f);
+            v4f vsum = set1(0.f);
+            float base[4] = {0.f, 1.f, 2.f, 3.f};
+            v4f vidx = load(base);
+            v4f vstep = set1(4.f);
+            for (; i + 4 <= reg_max; i += 4)
+            {
+                v4f e = exp(sub(load(src + i), va));
+                vden = add(vden, e);
+                vsum = fmadd(e, vidx, vsum);
+                vidx = add(vidx, vstep);
+            }
+            denominator = reduce_add(vden);
+            dis_sum = reduce_add(vsum);
+        }
+#endif
+        for (; i < reg_max; i++)
+        {
+            float e = std::exp(src[i] - alpha);
+            denominator += e;
+            dis_sum += (float)i * e;
+        }
+        return dis_sum / denominator;
+    }
+
+    /* distances (l, t, r, b) of one anchor, src holds 4 * reg_max logits */
+    static inline void dfl_decode(const float* src, int reg_max, float stride, float* ltrb)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            ltrb[k] = dfl_expectation(src + k * reg_max, reg_max) * stride;
+        }
+    }
+} // namespace simd
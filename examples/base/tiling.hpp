@@ -0,0 +1,287 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "base/simd.hpp"
+#include "utilities/thread_pool.hpp"
+
+/*
+ * Runs an image-to-image model with a fixed input size (super-resolution and
+ * the like) over images of any size. The image is cut into overlapping
+ * model-sized tiles, the outputs are blended with feathered weights over the
+ * overlaps, and finished output rows are handed out in order as 8 bit pixels.
+ * Only one band of tiles is kept in float, so memory does not grow with the
+ * image.
+ */
+namespace tiling
+{
+    /* saturating dst = round(src * scale) */
+    static void convert_u8(const float* src, uint8_t* dst, int n, float scale)
+    {
+        int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        const simd::v4f vs = simd::set1(scale);
+        const simd::v4f zero = simd::set1(0.f);
+        const simd::v4f top = simd::set1(255.f);
+        const simd::v4f half = simd::set1(0.5f);
+        float q[4];
+        for (; i + 4 <= n; i += 4)
+        {
+            simd::v4f v = simd::mul(simd::load(src + i), vs);
+            simd::store(q, simd::add(simd::min(simd::max(v, zero), top), half));
+            dst[i] = (uint8_t)q[0];
+            dst[i + 1] = (uint8_t)q[1];
+            dst[i + 2] = (uint8_t)q[2];
+            dst[i + 3] = (uint8_t)q[3];
+        }
+#endif
+        for (; i < n; i++)
+        {
+            dst[i] = (uint8_t)(std::min(std::max(src[i] * scale, 0.f), 255.f) + 0.5f);
+        }
+    }
+
+    /* tile origins along one axis, neighbours share at least `overlap` pixels and the last tile ends at the edge */
+    static std::vector<int> tile_origins(int size, int tile, int overlap)
+    {
+        if (size <= tile)
+            return {0};
+        overlap = std::min(std::max(overlap, 0), tile - 1);
+        const int count = (size - tile + (tile - overlap) - 1) / (tile - overlap) + 1;
+        std::vector<int> origins(count);
+        for (int i = 0; i < count; i++)
+        {
+            origins[i] = (int)((int64_t)i * (size - tile) / (count - 1));
+        }
+        return origins;
+    }
+
+    /* blend weights of one tile axis: ramps over the parts shared with the previous / next tile */
+    static void feather(int length, int shared_before, int shared_after, float* weights)
+    {
+        for (int p = 0; p < length; p++)
+        {
+            float w = 1.f;
+            if (shared_before > 0)
+                w = std::min(w, (p + 0.5f) / shared_before);
+            if (shared_after > 0)
+                w = std::min(w, (length - p - 0.5f) / shared_after);
+            weights[p] = w;
+        }
+    }
+
+    class TiledUpscaler
+    {
+    public:
+        /* tile size is the model input, scale the output / input ratio, channels interleaved (HWC) */
+        TiledUpscaler(int tile_w, int tile_h, int scale, int overlap, int channels = 3)
+            : tile_w_(tile_w), tile_h_(tile_h), scale_(scale), overlap_(overlap), channels_(channels), pool_(2)
+        {
+            for (auto& buffer : tiles_)
+            {
+                buffer.resize((size_t)tile_w * tile_h * channels);
+            }
+        }
+
+        /*
+         * infer(const std::vector<uint8_t>& tile) runs the model on one tile and
+         * returns its float output (tile_h * scale rows of tile_w * scale * channels,
+         * in [0, 1]). sink(int y, const uint8_t* row) receives every output row
+         * once, top to bottom. The next tile is prepared while infer() runs.
+         * infer() returns nullptr when the model fails, the run then stops and
+         * returns false; rows already handed to sink stay as they are.
+         */
+        template<typename Infer, typename Sink>
+        bool run(const cv::Mat& src, Infer&& infer, Sink&& sink)
+        {
+            const std::vector<int> xs = tile_origins(src.cols, tile_w_, overlap_);
+            const std::vector<int> ys = tile_origins(src.rows, tile_h_, overlap_);
+            const int out_w = src.cols * scale_;
+            const int out_h = src.rows * scale_;
+            const int band_rows = tile_h_ * scale_;
+            const int row_len = out_w * channels_;
+
+            acc_.assign((size_t)band_rows * row_len, 0.f);
+            wsum_.assign((size_t)band_rows * out_w, 0.f);
+            wx_.resize((size_t)tile_w_ * scale_ * channels_);
+            wx_pixel_.resize((size_t)tile_w_ * scale_);
+            wy_.resize(band_rows);
+            row_f_.resize(row_len);
+            row_u8_.resize(row_len);
+
+            const int count = (int)(xs.size() * ys.size());
+            prepare(src, xs[0], ys[0], tiles_[0]);
+
+            int band_y = 0; /* output row held in acc_ row 0 */
+            for (int t = 0; t < count; t++)
+            {
+                const int tx = t % (int)xs.size();
+                const int ty = t / (int)xs.size();
+
+                const float* out = nullptr;
+                pool_.parallel_for(2, [&](int job) {
+                    if (job == 0)
+                        out = infer(tiles_[t & 1]);
+                    else if (t + 1 < count)
+                        prepare(src, xs[(t + 1) % xs.size()], ys[(t + 1) / xs.size()], tiles_[(t + 1) & 1]);
+                });
+                if (out == nullptr)
+                    return false;
+
+                accumulate(out, xs, ys, tx, ty, src.cols, src.rows, band_y, out_w);
+
+                if (tx + 1 == (int)xs.size())
+                {
+                    /* rows above the next tile row are final */
+                    const int done = ty + 1 < (int)ys.size() ? ys[ty + 1] * scale_ : out_h;
+                    emit(band_y, done, out_w, sink);
+                    shift(done - band_y, band_rows, out_w);
+                    band_y = done;
+                }
+            }
+            return true;
+        }
+
+    private:
+        /* copies a tile of the source, replicating the border where the image is smaller than the tile */
+        void prepare(const cv::Mat& src, int x, int y, std::vector<uint8_t>& tile) const
+        {
+            const int w = std::min(tile_w_, src.cols - x);
+            const int h = std::min(tile_h_, src.rows - y);
+            const size_t pixel = (size_t)channels_;
+            for (int r = 0; r < tile_h_; r++)
+            {
+                const uint8_t* s = src.ptr<uint8_t>(y + std::min(r, h - 1)) + x * pixel;
+                uint8_t* d = tile.data() + (size_t)r * tile_w_ * pixel;
+                memcpy(d, s, w * pixel);
+                for (int c = w; c < tile_w_; c++)
+                {
+                    memcpy(d + c * pixel, s + (w - 1) * pixel, pixel);
+                }
+            }
+        }
+
+        void accumulate(const float* out, const std::vector<int>& xs, const std::vector<int>& ys, int tx, int ty, int src_w, int src_h, int band_y, int out_w)
+        {
+            const int x0 = xs[tx], y0 = ys[ty];
+            const int w = std::min(tile_w_, src_w - x0) * scale_;
+            const int h = std::min(tile_h_, src_h - y0) * scale_;
+            const int before_x = tx > 0 ? (xs[tx - 1] + tile_w_ - x0) * scale_ : 0;
+            const int after_x = tx + 1 < (int)xs.size() ? (x0 + tile_w_ - xs[tx + 1]) * scale_ : 0;
+            const int before_y = ty > 0 ? (ys[ty - 1] + tile_h_ - y0) * scale_ : 0;
+            const int after_y = ty + 1 < (int)ys.size() ? (y0 + tile_h_ - ys[ty + 1]) * scale_ : 0;
+
+            /* per pixel x weights, expanded per channel into wx_ for the vector loop */
+            feather(w, before_x, after_x, wx_pixel_.data());
+            for (int p = 0; p < w; p++)
+            {
+                for (int c = 0; c < channels_; c++)
+                {
+                    wx_[p * channels_ + c] = wx_pixel_[p];
+                }
+            }
+            feather(h, before_y, after_y, wy_.data());
+
+            const int n = w * channels_;
+            const int tile_stride = tile_w_ * scale_ * channels_;
+            for (int r = 0; r < h; r++)
+            {
+                const int row = y0 * scale_ + r - band_y;
+                const float wy = wy_[r];
+                const float* s = out + (size_t)r * tile_stride;
+                float* a = acc_.data() + (size_t)row * out_w * channels_ + (size_t)x0 * scale_ * channels_;
+                float* ws = wsum_.data() + (size_t)row * out_w + (size_t)x0 * scale_;
+
+                int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+                const simd::v4f vwy = simd::set1(wy);
+                for (; i + 4 <= n; i += 4)
+                {
+                    simd::v4f weight = simd::mul(simd::load(wx_.data() + i), vwy);
+                    simd::store(a + i, simd::fmadd(simd::load(s + i), weight, simd::load(a + i)));
+                }
+#endif
+                for (; i < n; i++)
+                {
+                    a[i] += s[i] * wx_[i] * wy;
+                }
+                for (int p = 0; p < w; p++)
+                {
+                    ws[p] += wx_pixel_[p] * wy;
+                }
+            }
+        }
+
+        template<typename Sink>
+        void emit(int band_y, int done, int out_w, Sink&& sink)
+        {
+            for (int y = band_y; y < done; y++)
+            {
+                const float* a = acc_.data() + (size_t)(y - band_y) * out_w * channels_;
+                const float* ws = wsum_.data() + (size_t)(y - band_y) * out_w;
+                for (int p = 0; p < out_w; p++)
+                {
+                    const float inv = 1.f / ws[p];
+                    for (int c = 0; c < channels_; c++)
+                    {
+                        row_f_[p * channels_ + c] = a[p * channels_ + c] * inv;
+                    }
+                }
+                convert_u8(row_f_.data(), row_u8_.data(), out_w * channels_, 255.f);
+                sink(y, row_u8_.data());
+            }
+        }
+
+        /* drops the first `rows` rows of the band, the overlap with the next tile row moves up */
+        void shift(int rows, int band_rows, int out_w)
+        {
+            const size_t acc_row = (size_t)out_w * channels_;
+            const int keep = band_rows - rows;
+            if (keep > 0)
+            {
+                memmove(acc_.data(), acc_.data() + rows * acc_row, keep * acc_row * sizeof(float));
+                memmove(wsum_.data(), wsum_.data() + (size_t)rows * out_w, (size_t)keep * out_w * sizeof(float));
+            }
+            const int from = std::max(keep, 0);
+            std::fill(acc_.begin() + from * acc_row, acc_.end(), 0.f);
+            std::fill(wsum_.begin() + (size_t)from * out_w, wsum_.end(), 0.f);
+        }
+
+        int tile_w_, tile_h_, scale_, overlap_, channels_;
+        utilities::thread_pool pool_;
+
+        /* two input tiles, one being inferred while the other is prepared */
+        std::vector<uint8_t> tiles_[2];
+
+        /* one band of tile_h * scale output rows */
+        std::vector<float> acc_;
+        std::vector<float> wsum_;
+
+        std::vector<float> wx_, wx_pixel_, wy_, row_f_;
+        std::vector<uint8_t> row_u8_;
+    };
+} // namespace tiling
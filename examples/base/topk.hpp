@@ -21,10 +21,14 @@
 #pragma once
 
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <cstdio>
 #include <vector>
 
 #include "base/score.hpp"
+#include "base/simd.hpp"
+#include "base/fast_math.hpp"
 
 
 namespace classification
@@ -44,9 +48,130 @@ namespace classification
 
     void print_score(const std::vector<score>& array, const size_t& n)
     {
-        for (size_t i = 0; i < n; i++)
+        for (size_t i = 0; i < std::min(n, array.size()); i++)
         {
             fprintf(stdout, "%.4f, %d\n", array[i].score, array[i].id);
         }
     }
+
+
+    /* ranking used by topk: higher score first, lower id first on ties */
+    static inline bool stronger(const score& a, const score& b)
+    {
+        return a.score > b.score || (a.score == b.score && a.id < b.id);
+    }
+
+
+    /*
+     * The k best of n raw scores, best first, without building or sorting a
+     * score per class. A k entry heap keeps the weakest winner at its root, and
+     * blocks of four scores that cannot beat it are skipped with one compare.
+     */
+    void topk(const float* scores, int n, int k, std::vector<score>& out)
+    {
+        out.clear();
+        k = std::max(0, std::min(k, n));
+        if (k == 0)
+            return;
+
+        out.reserve(k);
+        for (int i = 0; i < k; i++)
+        {
+            out.push_back({(uint32_t)i, scores[i]});
+        }
+        std::make_heap(out.begin(), out.end(), stronger);
+
+        auto push = [&](int i) {
+            if (scores[i] > out.front().score)
+            {
+                std::pop_heap(out.begin(), out.end(), stronger);
+                out.back() = {(uint32_t)i, scores[i]};
+                std::push_heap(out.begin(), out.end(), stronger);
+            }
+        };
+
+        int i = k;
+#if defined(AX_SAMPLES_SIMD)
+        for (; i + 4 <= n; i += 4)
+        {
+            if (!simd::any_ge(simd::load(scores + i), simd::set1(out.front().score)))
+                continue;
+            for (int j = i; j < i + 4; j++)
+            {
+                push(j);
+            }
+        }
+#endif
+        for (; i < n; i++)
+        {
+            push(i);
+        }
+
+        std::sort_heap(out.begin(), out.end(), stronger);
+    }
+
+
+    /*
+     * Turns the scores of `top` (the output of topk over the same n scores) into
+     * softmax probabilities. The other classes only contribute to the
+     * denominator, which is accumulated with the vector exp.
+     */
+    void softmax_topk(const float* scores, int n, std::vector<score>& top)
+    {
+        if (top.empty())
+            return;
+
+        const float alpha = top[0].score;
+        float sum = 0.f;
+        int i = 0;
+#if defined(AX_SAMPLES_SIMD)
+        simd::v4f a = simd::set1(alpha);
+        simd::v4f acc = simd::set1(0.f);
+        for (; i + 4 <= n; i += 4)
+        {
+            acc = simd::add(acc, simd::exp(simd::sub(simd::load(scores + i), a)));
+        }
+        sum = simd::reduce_add(acc);
+#endif
+        for (; i < n; i++)
+        {
+            sum += fast_math::exp_poly(scores[i] - alpha);
+        }
+
+        for (auto& t : top)
+        {
+            t.score = fast_math::exp_poly(t.score - alpha) / sum;
+        }
+    }
+
+
+    /*
+     * Multi-label heads: every label whose probability is above threshold, in
+     * label order. With logits = true the scores are pre-sigmoid, they are
+     * compared in logit space and only the survivors are passed through the
+     * sigmoid.
+     */
+    void multi_label(const float* scores, int n, float threshold, std::vector<score>& out, bool logits = false)
+    {
+        out.clear();
+        float cut = threshold;
+        if (logits)
+        {
+            if (threshold <= 0.f)
+                cut = -FLT_MAX;
+            else if (threshold >= 1.f)
+                return;
+            else
+                cut = -std::log(1.f / threshold - 1.f) - 1e-4f;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            if (!(scores[i] > cut))
+                continue;
+            float prob = logits ? fast_math::sigmoid(scores[i]) : scores[i];
+            if (prob > threshold)
+                out.push_back({(uint32_t)i, prob});
+        }
+    }
 }
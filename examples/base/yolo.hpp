@@ -26,6 +26,9 @@
 #include <algorithm>
 #include <cmath>
 
+#include "base/nms.hpp"
+#include "base/fast_math.hpp"
+
 namespace yolo
 {
     enum
@@ -53,7 +56,7 @@ namespace yolo
 
     static inline float sigmoid(float x)
     {
-        return (float)(1.f / (1.f + std::exp(-x)));
+        return fast_math::sigmoid(x);
     }
     static inline float intersection_area(const BBoxRect& a, const BBoxRect& b)
     {
@@ -107,12 +110,31 @@ namespace yolo
         qsort_descent_inplace(datas, 0, (int)(datas.size() - 1));
     }
 
-    static void nms_sorted_bboxes(std::vector<BBoxRect>& bboxes, std::vector<size_t>& picked, float nms_threshold)
+    static void nms_sorted_bboxes(std::vector<BBoxRect>& bboxes, std::vector<size_t>& picked, float nms_threshold, int nms_engine = nms::NMS_EXHAUSTIVE)
     {
         picked.clear();
 
         const size_t n = bboxes.size();
 
+        if (nms_engine == nms::NMS_GRID && nms_threshold >= 0.f)
+        {
+            std::vector<nms::Box> boxes(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                boxes[i] = {bboxes[i].xmin, bboxes[i].ymin, bboxes[i].xmax, bboxes[i].ymax};
+            }
+
+            bool done = nms::greedy_grid(boxes, picked, [&](int i, int j) {
+                const BBoxRect& a = bboxes[i];
+                const BBoxRect& b = bboxes[j];
+                float inter_area = intersection_area(a, b);
+                float union_area = a.area + b.area - inter_area;
+                return inter_area > nms_threshold * union_area;
+            });
+            if (done)
+                return;
+        }
+
         for (size_t i = 0; i < n; i++)
         {
             const BBoxRect& a = bboxes[i];
@@ -175,7 +197,7 @@ namespace yolo
     class YoloDetectionOutput
     {
     public:
-        int init(int version, float nms_threshold = 0.45f, float confidence_threshold = 0.48f, int class_num = 80);
+        int init(int version, float nms_threshold = 0.45f, float confidence_threshold = 0.48f, int class_num = 80, int nms_engine = nms::NMS_EXHAUSTIVE);
         int forward(const std::vector<TMat>& bottom_blobs, std::vector<TMat>& top_blobs);
         int forward_nhwc(const std::vector<TMat>& bottom_blobs, std::vector<TMat>& top_blobs);
 
@@ -188,9 +210,10 @@ namespace yolo
         float m_confidence_threshold;
         float m_confidence_threshold_unsigmoid;
         float m_nms_threshold;
+        int m_nms_engine;
     };
 
-    int YoloDetectionOutput::init(int version, float nms_threshold, float confidence_threshold, int class_num)
+    int YoloDetectionOutput::init(int version, float nms_threshold, float confidence_threshold, int class_num, int nms_engine)
     {
         memset(this, 0, sizeof(*this));
         m_num_box = 3;
@@ -313,6 +336,7 @@ namespace yolo
 
         m_confidence_threshold = confidence_threshold;
         m_nms_threshold = nms_threshold;
+        m_nms_engine = nms_engine;
         m_confidence_threshold_unsigmoid = -1.0f * (float)std::log((1.0f / m_confidence_threshold) - 1.0f);
 
         return 0;
@@ -357,7 +381,7 @@ namespace yolo
                         }
 
                         //sigmoid(box_score) * sigmoid(class_score)
-                        float confidence_1 = 1.0f / ((1.f + std::exp(-feature_ptr[4])) * (1.f + std::exp(-class_score)));
+                        float confidence_1 = 1.0f / ((1.f + fast_math::exp(-feature_ptr[4])) * (1.f + fast_math::exp(-class_score)));
                         if (confidence_1 >= m_confidence_threshold)
                         {
                             int biases_index = (int)(m_mask[box + mask_offset]);
@@ -368,8 +392,8 @@ namespace yolo
                             // fprintf(stderr, "%f %f %d \n", class_score, feature_ptr[4], class_index);
                             float bbox_cx = ((float)j + sigmoid(feature_ptr[0])) / (float)w;
                             float bbox_cy = ((float)i + sigmoid(feature_ptr[1])) / (float)h;
-                            auto bbox_w = (float)(std::exp(feature_ptr[2]) * bias_w / (float)net_w);
-                            auto bbox_h = (float)(std::exp(feature_ptr[3]) * bias_h / (float)net_h);
+                            auto bbox_w = (float)(fast_math::exp(feature_ptr[2]) * bias_w / (float)net_w);
+                            auto bbox_h = (float)(fast_math::exp(feature_ptr[3]) * bias_h / (float)net_h);
 
                             float bbox_xmin = bbox_cx - bbox_w * 0.5f;
                             float bbox_ymin = bbox_cy - bbox_h * 0.5f;
@@ -393,7 +417,7 @@ namespace yolo
 
         // apply nms
         std::vector<size_t> picked;
-        nms_sorted_bboxes(all_bbox_rects, picked, m_nms_threshold);
+        nms_sorted_bboxes(all_bbox_rects, picked, m_nms_threshold, m_nms_engine);
 
         // select
         std::vector<BBoxRect> bbox_rects;
@@ -493,15 +517,15 @@ namespace yolo
                         }
 
                         //sigmoid(box_score) * sigmoid(class_score)
-                        float confidence = (float)1.f / ((1.f + std::exp(-box_score_ptr[0]) * (1.f + std::exp(-class_score))));
+                        float confidence = (float)1.f / ((1.f + fast_math::exp(-box_score_ptr[0]) * (1.f + fast_math::exp(-class_score))));
                         if (confidence >= m_confidence_threshold)
                         {
                             // fprintf(stderr, "%f %d \n", class_score, class_index);
                             // region box
                             float bbox_cx = ((float)j + sigmoid(xptr[0])) / (float)w;
                             float bbox_cy = ((float)i + sigmoid(yptr[0])) / (float)h;
-                            auto bbox_w = (float)(std::exp(wptr[0]) * bias_w / (float)net_w);
-                            auto bbox_h = (float)(std::exp(hptr[0]) * bias_h / (float)net_h);
+                            auto bbox_w = (float)(fast_math::exp(wptr[0]) * bias_w / (float)net_w);
+                            auto bbox_h = (float)(fast_math::exp(hptr[0]) * bias_h / (float)net_h);
 
                             float bbox_xmin = bbox_cx - bbox_w * 0.5f;
                             float bbox_ymin = bbox_cy - bbox_h * 0.5f;
@@ -537,7 +561,7 @@ namespace yolo
 
         // apply nms
         std::vector<size_t> picked;
-        nms_sorted_bboxes(all_bbox_rects, picked, m_nms_threshold);
+        nms_sorted_bboxes(all_bbox_rects, picked, m_nms_threshold, m_nms_engine);
 
         // select
         std::vector<BBoxRect> bbox_rects;
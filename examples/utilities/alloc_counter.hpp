@@ -0,0 +1,115 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+/*
+ * Heap allocation counter for checking that a frame loop runs allocation free.
+ * It replaces the global operator new, so it is a debug tool: samples include
+ * it only when built with AX_SAMPLES_COUNT_ALLOCS (cmake -DAX_SAMPLES_COUNT_ALLOCS=ON),
+ * and from exactly one translation unit. Counts are kept per thread, so
+ * worker threads such as the mjpeg streamer do not pollute the measurement.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace utilities
+{
+    namespace alloc_counter
+    {
+        static inline uint64_t& thread_allocations()
+        {
+            static thread_local uint64_t count = 0;
+            return count;
+        }
+
+        static inline void* allocate(std::size_t size)
+        {
+            thread_allocations()++;
+            return std::malloc(size == 0 ? 1 : size);
+        }
+    } // namespace alloc_counter
+
+    /* allocations made by the current thread since construction */
+    class alloc_scope
+    {
+    public:
+        alloc_scope()
+            : start(alloc_counter::thread_allocations())
+        {
+        }
+
+        uint64_t count() const
+        {
+            return alloc_counter::thread_allocations() - start;
+        }
+
+    private:
+        uint64_t start;
+    };
+} // namespace utilities
+
+void* operator new(std::size_t size)
+{
+    void* p = utilities::alloc_counter::allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* p = utilities::alloc_counter::allocate(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return utilities::alloc_counter::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return utilities::alloc_counter::allocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
@@ -0,0 +1,157 @@
+/*
+ * AXERA is pleased to support the open source community by making ax-samples available.
+ *
+ * Copyright (c) 2022, AXERA Semiconductor (Shanghai) Co., Ltd. All rights reserved.
+ *
+ * Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+ * in compliance with the License. You may obtain a copy of the License at
+ *
+ * https://opensource.org/licenses/BSD-3-Clause
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ */
+
+/*
+ * Author:
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace utilities
+{
+    /*
+     * Small persistent pool for post-processing. parallel_for() hands out the
+     * indices [0, count) to the workers and the calling thread, and returns once
+     * every index ran. Dispatch does not allocate, so it is safe to use per frame.
+     */
+    class thread_pool
+    {
+    public:
+        /* num_threads counts the caller, 0 picks the hardware concurrency */
+        explicit thread_pool(int num_threads = 0)
+        {
+            if (num_threads <= 0)
+            {
+                num_threads = (int)std::thread::hardware_concurrency();
+            }
+            for (int i = 1; i < num_threads; i++)
+            {
+                workers.emplace_back([this]() { worker_loop(); });
+            }
+        }
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            job_cv.notify_all();
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        int size() const
+        {
+            return (int)workers.size() + 1;
+        }
+
+        template<typename Func>
+        void parallel_for(int count, Func&& func)
+        {
+            if (count <= 0)
+                return;
+
+            if (workers.empty() || count == 1)
+            {
+                for (int i = 0; i < count; i++)
+                {
+                    func(i);
+                }
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job_func = &invoke<typename std::remove_reference<Func>::type>;
+                job_ctx = (void*)&func;
+                job_count = count;
+                next_index = 0;
+                pending = (int)workers.size();
+                generation++;
+            }
+            job_cv.notify_all();
+
+            run_job();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            done_cv.wait(lock, [this]() { return pending == 0; });
+        }
+
+    private:
+        template<typename Func>
+        static void invoke(void* ctx, int index)
+        {
+            (*(Func*)ctx)(index);
+        }
+
+        void run_job()
+        {
+            for (int i = next_index.fetch_add(1); i < job_count; i = next_index.fetch_add(1))
+            {
+                job_func(job_ctx, i);
+            }
+        }
+
+        void worker_loop()
+        {
+            uint64_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                job_cv.wait(lock, [&]() { return stop || generation != seen; });
+                if (stop)
+                    return;
+                seen = generation;
+
+                lock.unlock();
+                run_job();
+                lock.lock();
+
+                if (--pending == 0)
+                {
+                    done_cv.notify_one();
+                }
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable job_cv;
+        std::condition_variable done_cv;
+
+        void (*job_func)(void*, int) = nullptr;
+        void* job_ctx = nullptr;
+        int job_count = 0;
+        std::atomic<int> next_index{0};
+        int pending = 0;
+        uint64_t generation = 0;
+        bool stop = false;
+    };
+} // namespace utilities